@@ -29,10 +29,13 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "styles/style_mediaview.h"
 #include "lang.h"
 #include "data/data_abstract_structure.h"
+#include "data/data_userpics.h"
 #include "history/history_service_layout.h"
 #include "history/history_location_manager.h"
 #include "history/history_media_types.h"
 #include "media/media_audio.h"
+#include "media/media_clip_reader.h"
+#include "ui/text/text_block.h"
 #include "inline_bots/inline_bot_layout_item.h"
 #include "application.h"
 #include "fileuploader.h"
@@ -62,6 +65,16 @@ namespace {
 	PhotosData photosData;
 	DocumentsData documentsData;
 
+	// Most documents share one of a few mime types.
+	QSet<QString> mimeTypes;
+	QString internedMime(const QString &mime) {
+		auto i = mimeTypes.constFind(mime);
+		if (i == mimeTypes.cend()) {
+			i = mimeTypes.insert(mime);
+		}
+		return *i;
+	}
+
 	using LocationsData = QHash<LocationCoords, LocationData*>;
 	LocationsData locationsData;
 
@@ -73,6 +86,10 @@ namespace {
 
 	PhotoItems photoItems;
 	DocumentItems documentItems;
+
+	// Media that had items and lost all of them, unloaded in checkImageCacheSize().
+	QSet<PhotoData*> photosWithoutItems;
+	QSet<DocumentData*> documentsWithoutItems;
 	WebPageItems webPageItems;
 	GameItems gameItems;
 	SharedContactItems sharedContactItems;
@@ -218,6 +235,7 @@ namespace {
 		globalNotifyChatsPtr = UnknownNotifySettings;
 		if (App::uploader()) App::uploader()->clear();
 		clearStorageImages();
+		Data::clearUserpics();
 		if (auto w = wnd()) {
 			w->updateConnectingStatus();
 			w->getTitle()->updateControlsVisibility();
@@ -1681,7 +1699,7 @@ namespace {
 				versionChanged = convert->setRemoteVersion(version);
 				convert->setRemoteLocation(dc, access);
 				convert->date = date;
-				convert->mime = mime;
+				convert->mime = internedMime(mime);
 				if (!thumb->isNull() && (convert->thumb->isNull() || convert->thumb->width() < thumb->width() || convert->thumb->height() < thumb->height() || versionChanged)) {
 					updateImage(convert->thumb, thumb);
 				}
@@ -1713,7 +1731,7 @@ namespace {
 			} else {
 				result = DocumentData::create(document, dc, access, version, attributes);
 				result->date = date;
-				result->mime = mime;
+				result->mime = internedMime(mime);
 				result->thumb = thumb;
 				result->size = size;
 				result->recountIsImage();
@@ -1731,7 +1749,7 @@ namespace {
 					result->setRemoteLocation(dc, access);
 				}
 				result->date = date;
-				result->mime = mime;
+				result->mime = internedMime(mime);
 				if (!thumb->isNull() && (result->thumb->isNull() || result->thumb->width() < thumb->width() || result->thumb->height() < thumb->height() || versionChanged)) {
 					result->thumb = thumb;
 				}
@@ -1916,6 +1934,94 @@ namespace {
 		}
 	}
 
+	void unloadMediaWithoutItems() {
+		// Userpics share their images with the profile photos through the storage images cache.
+		QSet<PhotoId> userpicPhotos;
+		QSet<StorageKey> userpicKeys;
+		for_const (auto peer, ::peersData) {
+			if (peer->photoId && peer->photoId != UnknownPeerPhotoId) {
+				userpicPhotos.insert(peer->photoId);
+			}
+			if (!peer->photoLoc.isNull()) {
+				userpicKeys.insert(storageKey(peer->photoLoc));
+			}
+		}
+		auto usedAsUserpic = [&userpicKeys](const ImagePtr &image) {
+			auto &location = image->location();
+			return !location.isNull() && userpicKeys.contains(storageKey(location));
+		};
+		for_const (auto photo, ::photosWithoutItems) {
+			if (userpicPhotos.contains(photo->id) || usedAsUserpic(photo->thumb) || usedAsUserpic(photo->medium) || usedAsUserpic(photo->full)) {
+				continue;
+			}
+			photo->unload();
+		}
+		::photosWithoutItems.clear();
+
+		auto &savedGifs = cSavedGifs();
+		for_const (auto document, ::documentsWithoutItems) {
+			if (!savedGifs.contains(document)) {
+				document->unload();
+			}
+		}
+		::documentsWithoutItems.clear();
+	}
+
+	QString mediaMemoryReport() {
+		auto photosWithItems = 0;
+		auto photosBytes = int64(0);
+		for_const (auto photo, ::photosData) {
+			if (!::photoItems.value(photo).isEmpty()) {
+				++photosWithItems;
+			}
+			photosBytes += sizeof(PhotoData);
+			photosBytes += photo->thumb->savedData().size() + photo->medium->savedData().size() + photo->full->savedData().size();
+		}
+
+		auto documentsWithItems = 0;
+		auto documentsBytes = int64(0);
+		for_const (auto document, ::documentsData) {
+			if (!::documentItems.value(document).isEmpty()) {
+				++documentsWithItems;
+			}
+			documentsBytes += sizeof(DocumentData);
+			documentsBytes += document->name.size() * sizeof(QChar);
+			documentsBytes += document->data().size() + document->thumb->savedData().size();
+			if (auto sticker = document->sticker()) {
+				documentsBytes += sticker->img->savedData().size();
+			}
+		}
+		auto mimeBytes = int64(0);
+		for_const (auto &mime, ::mimeTypes) {
+			mimeBytes += mime.size() * sizeof(QChar);
+		}
+
+		return qsl("photos: %1 (%2 with items) ~%3 kb, documents: %4 (%5 with items) ~%6 kb, mime types: %7 ~%8 kb, images: %9 kb").arg(::photosData.size()).arg(photosWithItems).arg(photosBytes / 1024).arg(::documentsData.size()).arg(documentsWithItems).arg(documentsBytes / 1024).arg(::mimeTypes.size()).arg(mimeBytes / 1024).arg(imageCacheSize() / 1024);
+	}
+
+	QString memoryReport() {
+		auto blocks = 0, items = 0;
+		for_const (auto history, ::histories.map) {
+			blocks += history->blocks.size();
+			for_const (auto block, history->blocks) {
+				items += block->items.size();
+			}
+		}
+		auto pool = base::pool::stats();
+
+		QStringList result;
+		result.push_back(qsl("Histories: %1, blocks: %2, items: %3, pool objects: %4 in %5 chunks").arg(::histories.map.size()).arg(blocks).arg(items).arg(pool.alive).arg(pool.chunks));
+		result.push_back(qsl("Texts: %1 blocks").arg(ITextBlock::aliveCount()));
+		result.push_back(qsl("Images: %1, userpics: %2 kb").arg(imagesMemoryReport()).arg(Data::userpicsCacheSize() / 1024));
+		result.push_back(qsl("Media: %1").arg(mediaMemoryReport()));
+		result.push_back(qsl("Clips: %1").arg(Media::Clip::MemoryReport()));
+		if (auto player = audioPlayer()) {
+			result.push_back(qsl("Audio: %1").arg(player->memoryReport()));
+		}
+		result.push_back(qsl("MTP: %1").arg(MTP::buffersMemoryReport()));
+		return result.join('\n');
+	}
+
 	MTPPhoto photoFromUserPhoto(MTPint userId, MTPint date, const MTPUserProfilePhoto &photo) {
 		if (photo.type() == mtpc_userProfilePhoto) {
 			const auto &uphoto(photo.c_userProfilePhoto());
@@ -2110,6 +2216,8 @@ namespace {
 		cSetAutoDownloadGif(0);
 		::photoItems.clear();
 		::documentItems.clear();
+		::photosWithoutItems.clear();
+		::documentsWithoutItems.clear();
 		::webPageItems.clear();
 		::gameItems.clear();
 		::sharedContactItems.clear();
@@ -2225,10 +2333,6 @@ namespace {
 			::emoji = new QPixmap(QLatin1String(EName));
             if (cRetina()) ::emoji->setDevicePixelRatio(cRetinaFactor());
 		}
-		if (!::emojiLarge) {
-			::emojiLarge = new QPixmap(QLatin1String(EmojiNames[EIndex + 1]));
-			if (cRetina()) ::emojiLarge->setDevicePixelRatio(cRetinaFactor());
-		}
 
 		QImage mask[4];
 		prepareCorners(LargeMaskCorners, msgRadius(), st::white, nullptr, mask);
@@ -2277,6 +2381,7 @@ namespace {
 		histories().clear();
 
 		clearStorageImages();
+		Data::clearUserpics();
 		cSetServerBackgrounds(WallPapers());
 
 		serviceImageCacheSize = imageCacheSize();
@@ -2304,6 +2409,7 @@ namespace {
 		otherEmojiMap.clear();
 
 		Data::clearGlobalStructures();
+		Data::clearUserpics();
 
 		clearAllImages();
 	}
@@ -2378,6 +2484,12 @@ namespace {
 	}
 
 	const QPixmap &emojiLarge() {
+		// Only the emoji panel and boxes need the large sprite,
+		// so it is not decoded at startup with the rest of the media.
+		if (!::emojiLarge) {
+			::emojiLarge = new QPixmap(QLatin1String(EmojiNames[EIndex + 1]));
+			if (cRetina()) ::emojiLarge->setDevicePixelRatio(cRetinaFactor());
+		}
 		return *::emojiLarge;
 	}
 
@@ -2409,8 +2521,11 @@ namespace {
 	void checkImageCacheSize() {
 		int64 nowImageCacheSize = imageCacheSize();
 		if (nowImageCacheSize > serviceImageCacheSize + MemoryForImageCache) {
+			DEBUG_LOG(("Media: before forget, %1").arg(mediaMemoryReport()));
 			App::forgetMedia();
+			unloadMediaWithoutItems();
 			serviceImageCacheSize = imageCacheSize();
+			DEBUG_LOG(("Media: after forget, %1").arg(mediaMemoryReport()));
 		}
 	}
 
@@ -2534,10 +2649,15 @@ namespace {
 
 	void regPhotoItem(PhotoData *data, HistoryItem *item) {
 		::photoItems[data].insert(item);
+		::photosWithoutItems.remove(data);
 	}
 
 	void unregPhotoItem(PhotoData *data, HistoryItem *item) {
-		::photoItems[data].remove(item);
+		auto &items = ::photoItems[data];
+		items.remove(item);
+		if (items.isEmpty()) {
+			::photosWithoutItems.insert(data);
+		}
 	}
 
 	const PhotoItems &photoItems() {
@@ -2550,10 +2670,15 @@ namespace {
 
 	void regDocumentItem(DocumentData *data, HistoryItem *item) {
 		::documentItems[data].insert(item);
+		::documentsWithoutItems.remove(data);
 	}
 
 	void unregDocumentItem(DocumentData *data, HistoryItem *item) {
-		::documentItems[data].remove(item);
+		auto &items = ::documentItems[data];
+		items.remove(item);
+		if (items.isEmpty()) {
+			::documentsWithoutItems.insert(data);
+		}
 	}
 
 	const DocumentItems &documentItems() {
@@ -160,6 +160,8 @@ namespace App {
 	GameData *gameSet(const GameId &game, GameData *convert, const uint64 &accessHash, const QString &shortName, const QString &title, const QString &description, PhotoData *photo, DocumentData *doc);
 	LocationData *location(const LocationCoords &coords);
 	void forgetMedia();
+	QString mediaMemoryReport(); // counts and approximate sizes of photos and documents
+	QString memoryReport(); // multiline, by subsystem: histories, texts, images, media, clips, audio, mtp
 
 	MTPPhoto photoFromUserPhoto(MTPint userId, MTPint date, const MTPUserProfilePhoto &photo);
 
@@ -221,6 +221,7 @@ void Application::singleInstanceChecked() {
 	}
 
 	Sandbox::start();
+	Logs::startupPhase("single instance check");
 
 	if (!Logs::started() || (!cManyInstance() && !Logs::instanceChecked())) {
 		new NotStartedWindow();
@@ -691,6 +692,7 @@ AppClass::AppClass() : QObject()
 	if (Local::oldSettingsVersion() < AppVersion) {
 		psNewVersion();
 	}
+	Logs::startupPhase("local settings");
 
 	if (cLaunchMode() == LaunchModeAutoStart && !cAutoStart()) {
 		psAutoStart(false, true);
@@ -728,12 +730,14 @@ AppClass::AppClass() : QObject()
 	}
 
 	application()->installTranslator(_translator = new Translator());
+	Logs::startupPhase("language");
 
 	style::startManager();
 	anim::startManager();
 	historyInit();
 	Media::Player::start();
 	Window::Notifications::start();
+	Logs::startupPhase("managers");
 
 	DEBUG_LOG(("Application Info: inited..."));
 
@@ -744,6 +748,7 @@ AppClass::AppClass() : QObject()
 	connect(&_mtpUnpauseTimer, SIGNAL(timeout()), this, SLOT(doMtpUnpause()));
 
 	connect(&killDownloadSessionsTimer, SIGNAL(timeout()), this, SLOT(killDownloadSessions()));
+	connect(&_memoryReportTimer, SIGNAL(timeout()), this, SLOT(onMemoryReport()));
 
 	DEBUG_LOG(("Application Info: starting app..."));
 
@@ -753,6 +758,7 @@ AppClass::AppClass() : QObject()
 	_window = new MainWindow();
 	_window->createWinId();
 	_window->init();
+	Logs::startupPhase("main window");
 
 	Sandbox::connect(SIGNAL(applicationStateChanged(Qt::ApplicationState)), this, SLOT(onAppStateChanged(Qt::ApplicationState)));
 
@@ -762,8 +768,10 @@ AppClass::AppClass() : QObject()
 
 	initLocationManager();
 	App::initMedia();
+	Logs::startupPhase("media");
 
 	Local::ReadMapState state = Local::readMap(QByteArray());
+	Logs::startupPhase("local map");
 	if (state == Local::ReadMapPassNeeded) {
 		Global::SetLocalPasscode(true);
 		Global::RefLocalPasscodeChanged().notify();
@@ -793,6 +801,10 @@ AppClass::AppClass() : QObject()
 	if (cStartToSettings()) {
 		_window->showSettings();
 	}
+	Logs::startupPhase("widgets");
+
+	// The window is painted in the next event loop iteration.
+	QTimer::singleShot(0, [] { Logs::startupFinished(); });
 
 #ifndef TDESKTOP_DISABLE_NETWORK_PROXY
 	QNetworkProxyFactory::setUseSystemConfiguration(true);
@@ -976,6 +988,15 @@ void AppClass::killDownloadSessions() {
 	}
 }
 
+void AppClass::onMemoryReport() {
+	if (!DebugLogging::Memory()) {
+		_memoryReportTimer.stop();
+		return;
+	}
+	DEBUG_LOG(("Memory Info:\n%1").arg(App::memoryReport()));
+	_memoryReportTimer.start(MemoryReportTimeout);
+}
+
 void AppClass::photoUpdated(const FullMsgId &msgId, bool silent, const MTPInputFile &file) {
 	if (!App::self()) return;
 
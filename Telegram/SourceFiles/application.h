@@ -195,6 +195,7 @@ public slots:
 	void onSwitchTestMode();
 
 	void killDownloadSessions();
+	void onMemoryReport();
 	void onAppStateChanged(Qt::ApplicationState state);
 
 	void call_handleHistoryUpdate();
@@ -217,5 +218,6 @@ private:
 	Translator *_translator;
 
 	SingleTimer _mtpUnpauseTimer;
+	SingleTimer _memoryReportTimer;
 
 };
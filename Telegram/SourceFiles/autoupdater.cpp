@@ -27,9 +27,11 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include <openssl/pem.h>
 #include <openssl/bio.h>
 #include <openssl/err.h>
+#include <openssl/sha.h>
 
 #ifdef Q_OS_WIN // use Lzma SDK for win
 #include <LzmaLib.h>
+#include <LzmaDec.h>
 #else // Q_OS_WIN
 #include <lzma.h>
 #endif // else of Q_OS_WIN
@@ -47,6 +49,180 @@ typedef int VerInt;
 typedef wchar_t VerChar;
 #endif // Q_OS_WIN
 
+namespace {
+
+// The update file is hashed, uncompressed and unpacked by parts of this size,
+// so we never hold the whole compressed or uncompressed update in memory.
+constexpr int kUnpackPartSize = 64 * 1024;
+
+#ifdef Q_OS_WIN // use Lzma SDK for win
+void *LzmaAlloc(void *p, size_t size) {
+	return malloc(size);
+}
+
+void LzmaFree(void *p, void *address) {
+	free(address);
+}
+
+ISzAlloc LzmaAllocator = { LzmaAlloc, LzmaFree };
+#endif // Q_OS_WIN
+
+// Sequential device that uncompresses the update file while it is being read.
+class UnpackDevice : public QIODevice {
+public:
+	UnpackDevice(QFile &input, qint64 compressedSize, qint64 uncompressedSize) : _input(input)
+	, _compressedLeft(compressedSize)
+	, _uncompressedLeft(uncompressedSize) {
+	}
+
+	bool init(const char *props);
+
+	bool isSequential() const override {
+		return true;
+	}
+
+	~UnpackDevice() {
+#ifdef Q_OS_WIN // use Lzma SDK for win
+		if (_inited) {
+			LzmaDec_Free(&_state, &LzmaAllocator);
+		}
+#else // Q_OS_WIN
+		if (_inited) {
+			lzma_end(&_stream);
+		}
+#endif // Q_OS_WIN
+	}
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override;
+	qint64 writeData(const char *data, qint64 maxSize) override {
+		return -1;
+	}
+
+private:
+	bool readInput();
+	qint64 fail() {
+		_failed = true;
+		return -1;
+	}
+
+	QFile &_input;
+	qint64 _compressedLeft;
+	qint64 _uncompressedLeft;
+	QByteArray _inBuffer;
+	int _inOffset = 0;
+	bool _inited = false;
+	bool _failed = false;
+
+#ifdef Q_OS_WIN // use Lzma SDK for win
+	CLzmaDec _state;
+#else // Q_OS_WIN
+	lzma_stream _stream = LZMA_STREAM_INIT;
+#endif // Q_OS_WIN
+
+};
+
+bool UnpackDevice::init(const char *props) {
+#ifdef Q_OS_WIN // use Lzma SDK for win
+	LzmaDec_Construct(&_state);
+	auto res = LzmaDec_Allocate(&_state, reinterpret_cast<const Byte*>(props), LZMA_PROPS_SIZE, &LzmaAllocator);
+	if (res != SZ_OK) {
+		LOG(("Update Error: could not init lzma decoder, code: %1").arg(res));
+		return false;
+	}
+	LzmaDec_Init(&_state);
+#else // Q_OS_WIN
+	lzma_ret ret = lzma_stream_decoder(&_stream, UINT64_MAX, LZMA_CONCATENATED);
+	if (ret != LZMA_OK) {
+		const char *msg;
+		switch (ret) {
+		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
+		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
+		default: msg = "Unknown error, possibly a bug"; break;
+		}
+		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
+		return false;
+	}
+#endif // Q_OS_WIN
+	_inited = true;
+	return open(QIODevice::ReadOnly);
+}
+
+bool UnpackDevice::readInput() {
+	_inBuffer = _input.read(qMin(_compressedLeft, qint64(kUnpackPartSize)));
+	_inOffset = 0;
+	if (_inBuffer.isEmpty()) {
+		LOG(("Update Error: could not read compressed data, %1 bytes left").arg(_compressedLeft));
+		return false;
+	}
+	_compressedLeft -= _inBuffer.size();
+	return true;
+}
+
+qint64 UnpackDevice::readData(char *data, qint64 maxSize) {
+	if (_failed) {
+		return -1;
+	}
+
+	// We never uncompress more than the size written in the update header.
+	accumulate_min(maxSize, _uncompressedLeft);
+	auto result = qint64(0);
+	while (result < maxSize) {
+		if (_inOffset == _inBuffer.size() && _compressedLeft > 0 && !readInput()) {
+			return fail();
+		}
+		auto inAvailable = _inBuffer.size() - _inOffset;
+		auto in = reinterpret_cast<const uchar*>(_inBuffer.constData()) + _inOffset;
+		auto out = reinterpret_cast<uchar*>(data) + result;
+
+#ifdef Q_OS_WIN // use Lzma SDK for win
+		SizeT inLen = inAvailable, outLen = maxSize - result;
+		ELzmaStatus status;
+		auto res = LzmaDec_DecodeToBuf(&_state, out, &outLen, in, &inLen, LZMA_FINISH_ANY, &status);
+		if (res != SZ_OK) {
+			LOG(("Update Error: could not uncompress lzma, code: %1").arg(res));
+			return fail();
+		}
+		auto consumed = qint64(inLen), produced = qint64(outLen);
+#else // Q_OS_WIN
+		_stream.next_in = in;
+		_stream.avail_in = inAvailable;
+		_stream.next_out = out;
+		_stream.avail_out = maxSize - result;
+
+		lzma_ret res = lzma_code(&_stream, (_compressedLeft > 0) ? LZMA_RUN : LZMA_FINISH);
+		if (res != LZMA_OK && res != LZMA_STREAM_END) {
+			const char *msg;
+			switch (res) {
+			case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
+			case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
+			case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
+			case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
+			case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
+			default: msg = "Unknown error, possibly a bug"; break;
+			}
+			LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+			return fail();
+		}
+		auto consumed = qint64(inAvailable - _stream.avail_in), produced = qint64(maxSize - result - _stream.avail_out);
+#endif // Q_OS_WIN
+
+		_inOffset += consumed;
+		result += produced;
+		_uncompressedLeft -= produced;
+		// The decoder can stop making progress with some input left, for example
+		// after the end mark, so any iteration without progress is a failure.
+		if (!consumed && !produced) {
+			LOG(("Error in decompression, %1 bytes were not uncompressed").arg(_uncompressedLeft));
+			return fail();
+		}
+	}
+	return result;
+}
+
+} // namespace
+
 UpdateChecker::UpdateChecker(QThread *thread, const QString &url) : reply(0), already(0), full(0) {
 	updateUrl = url;
 	moveToThread(thread);
@@ -89,16 +265,9 @@ void UpdateChecker::initOutput() {
 			if (goodSize % UpdateChunk) {
 				goodSize = goodSize - (goodSize % UpdateChunk);
 				if (goodSize) {
-					if (outputFile.open(QIODevice::ReadOnly)) {
-						QByteArray goodData = outputFile.readAll().mid(0, goodSize);
-						outputFile.close();
-						if (outputFile.open(QIODevice::WriteOnly)) {
-							outputFile.write(goodData);
-							outputFile.close();
-
-							QMutexLocker lock(&mutex);
-							already = goodSize;
-						}
+					if (outputFile.resize(goodSize)) {
+						QMutexLocker lock(&mutex);
+						already = goodSize;
 					}
 				}
 			} else {
@@ -216,6 +385,7 @@ void UpdateChecker::partFailed(QNetworkReply::NetworkError e) {
 }
 
 void UpdateChecker::fatalFail() {
+	outputFile.close();
 	clearAll();
 	Sandbox::updateFailed();
 }
@@ -252,13 +422,12 @@ void UpdateChecker::unpackUpdate() {
 	const int32 hSigLen = 128, hShaLen = 20, hPropsLen = 0, hOriginalSizeLen = sizeof(int32), hSize = hSigLen + hShaLen + hOriginalSizeLen; // header
 #endif // Q_OS_WIN
 
-	QByteArray compressed = outputFile.readAll();
-	int32 compressedLen = compressed.size() - hSize;
-	if (compressedLen <= 0) {
-		LOG(("Update Error: bad compressed size: %1").arg(compressed.size()));
+	char header[hSize];
+	qint64 compressedLen = outputFile.size() - hSize;
+	if (compressedLen <= 0 || outputFile.read(header, hSize) != hSize) {
+		LOG(("Update Error: bad compressed size: %1").arg(outputFile.size()));
 		return fatalFail();
 	}
-	outputFile.close();
 
 	QString tempDirPath = cWorkingDir() + qsl("tupdates/temp"), readyFilePath = cWorkingDir() + qsl("tupdates/temp/ready");
 	psDeleteDir(tempDirPath);
@@ -270,7 +439,22 @@ void UpdateChecker::unpackUpdate() {
 	}
 
 	uchar sha1Buffer[20];
-	bool goodSha1 = !memcmp(compressed.constData() + hSigLen, hashSha1(compressed.constData() + hSigLen + hShaLen, compressedLen + hPropsLen + hOriginalSizeLen, sha1Buffer), hShaLen);
+	{
+		SHA_CTX sha1;
+		SHA1_Init(&sha1);
+		SHA1_Update(&sha1, header + hSigLen + hShaLen, hPropsLen + hOriginalSizeLen);
+		QByteArray part;
+		for (auto left = compressedLen; left > 0; left -= part.size()) {
+			part = outputFile.read(qMin(left, qint64(kUnpackPartSize)));
+			if (part.isEmpty()) {
+				LOG(("Update Error: cant read updates file!"));
+				return fatalFail();
+			}
+			SHA1_Update(&sha1, part.constData(), part.size());
+		}
+		SHA1_Final(sha1Buffer, &sha1);
+	}
+	bool goodSha1 = !memcmp(header + hSigLen, sha1Buffer, hShaLen);
 	if (!goodSha1) {
 		LOG(("Update Error: bad SHA1 hash of update file!"));
 		return fatalFail();
@@ -281,7 +465,7 @@ void UpdateChecker::unpackUpdate() {
 		LOG(("Update Error: cant read public rsa key!"));
 		return fatalFail();
 	}
-	if (RSA_verify(NID_sha1, (const uchar*)(compressed.constData() + hSigLen), hShaLen, (const uchar*)(compressed.constData()), hSigLen, pbKey) != 1) { // verify signature
+	if (RSA_verify(NID_sha1, (const uchar*)(header + hSigLen), hShaLen, (const uchar*)(header), hSigLen, pbKey) != 1) { // verify signature
 		RSA_free(pbKey);
 		if (cAlphaVersion() || cBetaVersion()) { // try other public key, if we are in alpha or beta version
 			pbKey = PEM_read_bio_RSAPublicKey(BIO_new_mem_buf(const_cast<char*>(AppAlphaVersion ? UpdatesPublicKey : UpdatesPublicAlphaKey), -1), 0, 0, 0);
@@ -289,7 +473,7 @@ void UpdateChecker::unpackUpdate() {
 				LOG(("Update Error: cant read public rsa key!"));
 				return fatalFail();
 			}
-			if (RSA_verify(NID_sha1, (const uchar*)(compressed.constData() + hSigLen), hShaLen, (const uchar*)(compressed.constData()), hSigLen, pbKey) != 1) { // verify signature
+			if (RSA_verify(NID_sha1, (const uchar*)(header + hSigLen), hShaLen, (const uchar*)(header), hSigLen, pbKey) != 1) { // verify signature
 				RSA_free(pbKey);
 				LOG(("Update Error: bad RSA signature of update file!"));
 				return fatalFail();
@@ -301,72 +485,23 @@ void UpdateChecker::unpackUpdate() {
 	}
 	RSA_free(pbKey);
 
-	QByteArray uncompressed;
-
 	int32 uncompressedLen;
-	memcpy(&uncompressedLen, compressed.constData() + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
-	uncompressed.resize(uncompressedLen);
-
-	size_t resultLen = uncompressed.size();
-#ifdef Q_OS_WIN // use Lzma SDK for win
-	SizeT srcLen = compressedLen;
-	int uncompressRes = LzmaUncompress((uchar*)uncompressed.data(), &resultLen, (const uchar*)(compressed.constData() + hSize), &srcLen, (const uchar*)(compressed.constData() + hSigLen + hShaLen), LZMA_PROPS_SIZE);
-	if (uncompressRes != SZ_OK) {
-		LOG(("Update Error: could not uncompress lzma, code: %1").arg(uncompressRes));
+	memcpy(&uncompressedLen, header + hSigLen + hShaLen + hPropsLen, hOriginalSizeLen);
+	if (uncompressedLen <= 0 || !outputFile.seek(hSize)) {
+		LOG(("Update Error: bad uncompressed size: %1").arg(uncompressedLen));
 		return fatalFail();
 	}
-#else // Q_OS_WIN
-	lzma_stream stream = LZMA_STREAM_INIT;
 
-	lzma_ret ret = lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED);
-	if (ret != LZMA_OK) {
-		const char *msg;
-		switch (ret) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Specified preset is not supported"; break;
-		case LZMA_UNSUPPORTED_CHECK: msg = "Specified integrity check is not supported"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error initializing the decoder: %1 (error code %2)").arg(msg).arg(ret));
-		return fatalFail();
-	}
-
-	stream.avail_in = compressedLen;
-	stream.next_in = (uint8_t*)(compressed.constData() + hSize);
-	stream.avail_out = resultLen;
-	stream.next_out = (uint8_t*)uncompressed.data();
-
-	lzma_ret res = lzma_code(&stream, LZMA_FINISH);
-	if (stream.avail_in) {
-		LOG(("Error in decompression, %1 bytes left in _in of %2 whole.").arg(stream.avail_in).arg(compressedLen));
-		return fatalFail();
-	} else if (stream.avail_out) {
-		LOG(("Error in decompression, %1 bytes free left in _out of %2 whole.").arg(stream.avail_out).arg(resultLen));
-		return fatalFail();
-	}
-	lzma_end(&stream);
-	if (res != LZMA_OK && res != LZMA_STREAM_END) {
-		const char *msg;
-		switch (res) {
-		case LZMA_MEM_ERROR: msg = "Memory allocation failed"; break;
-		case LZMA_FORMAT_ERROR: msg = "The input data is not in the .xz format"; break;
-		case LZMA_OPTIONS_ERROR: msg = "Unsupported compression options"; break;
-		case LZMA_DATA_ERROR: msg = "Compressed file is corrupt"; break;
-		case LZMA_BUF_ERROR: msg = "Compressed data is truncated or otherwise corrupt"; break;
-		default: msg = "Unknown error, possibly a bug"; break;
-		}
-		LOG(("Error in decompression: %1 (error code %2)").arg(msg).arg(res));
+	UnpackDevice uncompressed(outputFile, compressedLen, uncompressedLen);
+	if (!uncompressed.init(header + hSigLen + hShaLen)) {
 		return fatalFail();
 	}
-#endif // Q_OS_WIN
 
 	tempDir.mkdir(tempDir.absolutePath());
 
 	quint32 version;
 	{
-		QBuffer buffer(&uncompressed);
-		buffer.open(QIODevice::ReadOnly);
-		QDataStream stream(&buffer);
+		QDataStream stream(&uncompressed);
 		stream.setVersion(QDataStream::Qt_5_1);
 
 		stream >> version;
@@ -401,22 +536,21 @@ void UpdateChecker::unpackUpdate() {
 			LOG(("Update Error: update is empty!"));
 			return fatalFail();
 		}
+		QByteArray part(kUnpackPartSize, Qt::Uninitialized);
 		for (uint32 i = 0; i < filesCount; ++i) {
 			QString relativeName;
-			quint32 fileSize;
-			QByteArray fileInnerData;
+			quint32 fileSize, fileInnerDataSize;
 			bool executable = false;
 
-			stream >> relativeName >> fileSize >> fileInnerData;
-#if defined Q_OS_MAC || defined Q_OS_LINUX
-			stream >> executable;
-#endif // Q_OS_MAC || Q_OS_LINUX
+			// The file data is a serialized QByteArray, we read its size
+			// and then copy the contents to the file by parts.
+			stream >> relativeName >> fileSize >> fileInnerDataSize;
 			if (stream.status() != QDataStream::Ok) {
 				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
 				return fatalFail();
 			}
-			if (fileSize != quint32(fileInnerData.size())) {
-				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerData.size()));
+			if (fileSize != fileInnerDataSize) {
+				LOG(("Update Error: bad file size %1 not matching data size %2").arg(fileSize).arg(fileInnerDataSize));
 				return fatalFail();
 			}
 
@@ -429,12 +563,28 @@ void UpdateChecker::unpackUpdate() {
 				LOG(("Update Error: cant open file '%1' for writing").arg(tempDirPath + '/' + relativeName));
 				return fatalFail();
 			}
-			if (f.write(fileInnerData) != fileSize) {
-				f.close();
-				LOG(("Update Error: cant write file '%1'").arg(tempDirPath + '/' + relativeName));
-				return fatalFail();
+			for (auto left = fileSize; left > 0;) {
+				auto partSize = qMin(left, quint32(kUnpackPartSize));
+				if (stream.readRawData(part.data(), partSize) != int(partSize)) {
+					f.close();
+					LOG(("Update Error: cant read file '%1' from downloaded stream, status: %2").arg(relativeName).arg(stream.status()));
+					return fatalFail();
+				}
+				if (f.write(part.constData(), partSize) != qint64(partSize)) {
+					f.close();
+					LOG(("Update Error: cant write file '%1'").arg(tempDirPath + '/' + relativeName));
+					return fatalFail();
+				}
+				left -= partSize;
 			}
 			f.close();
+#if defined Q_OS_MAC || defined Q_OS_LINUX
+			stream >> executable;
+			if (stream.status() != QDataStream::Ok) {
+				LOG(("Update Error: cant read file from downloaded stream, status: %1").arg(stream.status()));
+				return fatalFail();
+			}
+#endif // Q_OS_MAC || Q_OS_LINUX
 			if (executable) {
 				QFileDevice::Permissions p = f.permissions();
 				p |= QFileDevice::ExeOwner | QFileDevice::ExeUser | QFileDevice::ExeGroup | QFileDevice::ExeOther;
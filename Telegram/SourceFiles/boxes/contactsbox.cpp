@@ -1474,7 +1474,7 @@ void ContactsBox::Inner::updateFilter(QString filter) {
 	_time = unixtime();
 	QStringList f;
 	if (!filter.isEmpty()) {
-		QStringList filterList = filter.split(cWordSplit(), QString::SkipEmptyParts);
+		QStringList filterList = textSplitWords(filter);
 		int l = filterList.size();
 
 		f.reserve(l);
@@ -685,7 +685,7 @@ void ShareBox::Inner::updateFilter(QString filter) {
 
 	QStringList f;
 	if (!filter.isEmpty()) {
-		QStringList filterList = filter.split(cWordSplit(), QString::SkipEmptyParts);
+		QStringList filterList = textSplitWords(filter);
 		int l = filterList.size();
 
 		f.reserve(l);
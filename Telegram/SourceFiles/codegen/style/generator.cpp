@@ -619,23 +619,27 @@ QByteArray iconMaskValuePng(const QString &filepath) {
 		common::logError(kErrorBadIconSize, filepath + ".png") << "bad icons size, 1x: " << png100x.width() << "x" << png100x.height() << ", 2x: " << png200x.width() << "x" << png200x.height();
 		return result;
 	}
-	QImage png125x = png200x.scaled(structure::data::pxAdjust(png100x.width(), 5), structure::data::pxAdjust(png100x.height(), 5), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-	QImage png150x = png200x.scaled(structure::data::pxAdjust(png100x.width(), 6), structure::data::pxAdjust(png100x.height(), 6), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	QImage png125x = png200x.scaled(structure::data::pxAdjust(png100x.width(), 5), structure::data::pxAdjust(png100x.height(), 5), Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(png100x.format());
+	QImage png150x = png200x.scaled(structure::data::pxAdjust(png100x.width(), 6), structure::data::pxAdjust(png100x.height(), 6), Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(png100x.format());
 
-	QImage composed(png200x.width() + png100x.width(), png200x.height() + png150x.height(), png100x.format());
-	{
-		QPainter p(&composed);
-		p.setCompositionMode(QPainter::CompositionMode_Source);
-		p.fillRect(0, 0, composed.width(), composed.height(), QColor(0, 0, 0, 255));
-		p.drawImage(0, 0, png200x);
-		p.drawImage(png200x.width(), 0, png100x);
-		p.drawImage(0, png200x.height(), png150x);
-		p.drawImage(png150x.width(), png200x.height(), png125x);
-	}
+	// Each scale is saved as a separate png in the order 100x, 125x, 150x, 200x,
+	// so that the application decodes only the mask for the scale it uses.
+	QLatin1String scalesTag("SCALES:");
+	result.append(scalesTag.data(), scalesTag.size());
 	{
 		QBuffer buffer(&result);
-		composed.save(&buffer, "PNG");
-//		composed.save(filePath + "@final.png", "PNG");
+		buffer.open(QIODevice::Append);
+
+		QDataStream stream(&buffer);
+		stream.setVersion(QDataStream::Qt_5_1);
+		for (auto image : { &png100x, &png125x, &png150x, &png200x }) {
+			QByteArray png;
+			{
+				QBuffer pngBuffer(&png);
+				image->save(&pngBuffer, "PNG");
+			}
+			stream << png;
+		}
 	}
 	return result;
 }
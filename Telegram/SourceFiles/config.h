@@ -46,8 +46,14 @@ enum {
 	MTPTcpConnectionWaitTimeout = 2000, // 2 seconds waiting for tcp, until we accept http
 	MTPIPv4ConnectionWaitTimeout = 1000, // 1 seconds waiting for ipv4, until we accept ipv6
 	MTPMillerRabinIterCount = 30, // 30 Miller-Rabin iterations for dh_prime primality check
-
-	MTPUploadSessionsCount = 2, // max 2 upload sessions is created
+	MTPCheckedDhPrimesCount = 8, // remember max 8 checked dh_prime and g pairs
+	MTPReceiveFrameBudget = 8, // handle received responses for 8ms, then let the event loop run
+	MTPContainerRequestsLimit = 64, // when more requests wait, they are packed by the weights of their priorities
+	MTPBackgroundRequestsInFlight = 16, // max background priority requests waiting for the response
+	MTPBulkRequestsInFlight = 4, // max bulk priority requests waiting for the response
+	MTPQueueingStatsPeriod = 100, // log the queueing delay after each 100 sent requests of a priority
+
+	MTPUploadSessionsCount = 4, // max 4 upload sessions is created
 	MTPDownloadSessionsCount = 2, // max 2 download sessions is created
 	MTPKillFileSessionTimeout = 5000, // how much time without upload / download causes additional session kill
 
@@ -146,6 +152,7 @@ enum {
 	MaxHttpRedirects = 5, // when getting external data/images
 
 	WriteMapTimeout = 1000,
+	MemoryReportTimeout = 600000, // log memory usage each 10 minutes when enabled
 	SaveDraftTimeout = 1000, // save draft after 1 secs of not changing text
 	SaveDraftAnywayTimeout = 5000, // or save anyway each 5 secs
 	SaveCloudDraftIdleTimeout = 14000, // save draft to the cloud after 14 more seconds
@@ -350,6 +357,8 @@ enum {
 	MessagesPerPage = 50, // next history part size
 
 	FileLoaderQueueStopTimeout = 5000,
+	FileLoaderQueueMaxThreads = 8, // no more than 8 files are prepared at the same time
+	FileLoaderQueueMemoryLimit = 512 * 1024 * 1024, // estimated memory of files being prepared at the same time
 
 	DownloadPartSize = 64 * 1024, // 64kb for photo
 	DocumentDownloadPartSize = 128 * 1024, // 128kb for document
@@ -367,6 +376,13 @@ enum {
     DocumentUploadPartSize3 = 256 * 1024, // 256kb for medium document ( <= 750mb )
     DocumentUploadPartSize4 = 512 * 1024, // 512kb for large document ( <= 1500mb )
     MaxUploadFileParallelSize = MTPUploadSessionsCount * 512 * 1024, // max 512kb uploaded at the same time in each session
+	MinUploadFileParallelSize = 512 * 1024, // bytes in flight never shrink below one largest part
+	StartUploadFileParallelSize = 1024 * 1024, // bytes in flight allowed before any part is acked
+	UploadFileParallelSizeStep = 128 * 1024, // bytes in flight grow by 128kb for each fast ack
+	UploadGoodAckLatency = 1500, // parts acked faster than 1.5 sec let more bytes in flight
+	UploadBadAckLatency = 5000, // parts acked slower than 5 sec cut bytes in flight
+	UploadFilesInParallel = 3, // parts of 3 queued files are interleaved
+	UploadResumeTimeout = 3600, // resume big file uploads with parts uploaded less than 1 hour ago
     UploadRequestInterval = 500, // one part each half second, if not uploaded faster
 
 	MaxPhotosInMemory = 50, // try to clear some memory after 50 photos are created
@@ -386,16 +402,6 @@ enum {
 	ForwardOnAdd = 100, // how many messages from chat history server should forward to user, that was added to this chat
 };
 
-inline const QRegularExpression &cWordSplit() {
-	static QRegularExpression regexp(qsl("[\\@\\s\\-\\+\\(\\)\\[\\]\\{\\}\\<\\>\\,\\.\\:\\!\\_\\;\\\"\\'\\x0]"));
-	return regexp;
-}
-
-inline const QRegularExpression &cRussianLetters() {
-	static QRegularExpression regexp(QString::fromUtf8("[а-яА-ЯёЁ]"));
-	return regexp;
-}
-
 inline QStringList cImgExtensions() {
 	static QStringList imgExtensions;
 	if (imgExtensions.isEmpty()) {
@@ -0,0 +1,214 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#include "stdafx.h"
+#include "core/memory_pool.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else // Q_OS_WIN
+#include <sys/mman.h>
+#endif // Q_OS_WIN
+
+namespace base {
+namespace pool {
+namespace {
+
+constexpr std::size_t kGranularity = 16;
+constexpr std::size_t kMaxPooledSize = 1024;
+constexpr std::size_t kChunkSize = 64 * 1024; // chunks are aligned by their size
+constexpr quintptr kChunkMask = ~quintptr(kChunkSize - 1);
+constexpr int kSizeClassesCount = kMaxPooledSize / kGranularity;
+
+struct FreeSlot {
+	FreeSlot *next;
+};
+
+// Header in the beginning of each chunk, the slots follow it.
+struct Chunk {
+	Chunk *prev; // in the list of chunks that have free slots
+	Chunk *next;
+	FreeSlot *free;
+	char *position; // not yet used part of the chunk
+	char *end;
+	int alive;
+};
+
+constexpr std::size_t kChunkHeaderSize = ((sizeof(Chunk) + kGranularity - 1) / kGranularity) * kGranularity;
+
+struct SizeClass {
+	Chunk *available = nullptr; // chunks that have free slots
+};
+
+SizeClass SizeClasses[kSizeClassesCount];
+Stats Counters;
+
+int sizeClassIndex(std::size_t size) {
+	return (size + kGranularity - 1) / kGranularity - 1;
+}
+
+Chunk *chunkOf(void *data) {
+	return reinterpret_cast<Chunk*>(reinterpret_cast<quintptr>(data) & kChunkMask);
+}
+
+bool chunkFull(const Chunk *chunk) {
+	return !chunk->free && chunk->position == chunk->end;
+}
+
+void linkChunk(SizeClass &sizeClass, Chunk *chunk) {
+	chunk->prev = nullptr;
+	chunk->next = sizeClass.available;
+	if (chunk->next) {
+		chunk->next->prev = chunk;
+	}
+	sizeClass.available = chunk;
+}
+
+void unlinkChunk(SizeClass &sizeClass, Chunk *chunk) {
+	if (chunk->prev) {
+		chunk->prev->next = chunk->next;
+	} else {
+		sizeClass.available = chunk->next;
+	}
+	if (chunk->next) {
+		chunk->next->prev = chunk->prev;
+	}
+	chunk->prev = chunk->next = nullptr;
+}
+
+// Chunks are mapped from the system directly, so that the memory of a released
+// chunk is returned to the system and not kept in the heap between other objects.
+void *mapChunk() {
+#ifdef Q_OS_WIN
+	// The allocation granularity is 64kb, so the chunk is aligned already.
+	return VirtualAlloc(nullptr, kChunkSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else // Q_OS_WIN
+	auto size = kChunkSize * 2;
+	auto mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapped == MAP_FAILED) {
+		return nullptr;
+	}
+
+	// Unmap the parts before and after the aligned chunk.
+	auto begin = reinterpret_cast<quintptr>(mapped);
+	auto aligned = (begin + kChunkSize - 1) & kChunkMask;
+	if (aligned > begin) {
+		munmap(mapped, aligned - begin);
+	}
+	if (begin + size > aligned + kChunkSize) {
+		munmap(reinterpret_cast<void*>(aligned + kChunkSize), begin + size - aligned - kChunkSize);
+	}
+	return reinterpret_cast<void*>(aligned);
+#endif // Q_OS_WIN
+}
+
+void unmapChunk(void *chunk) {
+#ifdef Q_OS_WIN
+	VirtualFree(chunk, 0, MEM_RELEASE);
+#else // Q_OS_WIN
+	munmap(chunk, kChunkSize);
+#endif // Q_OS_WIN
+}
+
+Chunk *createChunk(std::size_t slotSize) {
+	auto memory = mapChunk();
+	t_assert(memory != nullptr);
+	t_assert((reinterpret_cast<quintptr>(memory) & ~kChunkMask) == 0);
+	++Counters.chunks;
+
+	auto result = static_cast<Chunk*>(memory);
+	auto slots = static_cast<char*>(memory) + kChunkHeaderSize;
+	result->prev = result->next = nullptr;
+	result->free = nullptr;
+	result->position = slots;
+	result->end = slots + ((kChunkSize - kChunkHeaderSize) / slotSize) * slotSize;
+	result->alive = 0;
+	return result;
+}
+
+void destroyChunk(Chunk *chunk) {
+	--Counters.chunks;
+	++Counters.chunksReleased;
+	unmapChunk(chunk);
+}
+
+} // namespace
+
+void *allocate(std::size_t size) {
+	++Counters.allocations;
+	++Counters.alive;
+	if (!size || size > kMaxPooledSize) {
+		return operator new(size);
+	}
+
+	auto index = sizeClassIndex(size);
+	auto &sizeClass = SizeClasses[index];
+	auto chunk = sizeClass.available;
+	if (!chunk) {
+		chunk = createChunk((index + 1) * kGranularity);
+		linkChunk(sizeClass, chunk);
+	}
+
+	void *result = nullptr;
+	if (auto slot = chunk->free) {
+		chunk->free = slot->next;
+		result = slot;
+	} else {
+		result = chunk->position;
+		chunk->position += (index + 1) * kGranularity;
+	}
+	++chunk->alive;
+	if (chunkFull(chunk)) {
+		unlinkChunk(sizeClass, chunk);
+	}
+	return result;
+}
+
+void release(void *data, std::size_t size) {
+	if (!data) return;
+
+	--Counters.alive;
+	if (!size || size > kMaxPooledSize) {
+		return operator delete(data);
+	}
+
+	auto &sizeClass = SizeClasses[sizeClassIndex(size)];
+	auto chunk = chunkOf(data);
+	if (chunkFull(chunk)) {
+		linkChunk(sizeClass, chunk);
+	}
+	auto slot = static_cast<FreeSlot*>(data);
+	slot->next = chunk->free;
+	chunk->free = slot;
+
+	// The last chunk with free slots is kept even if it is empty, so that
+	// allocating and releasing one object doesn't take a chunk each time.
+	if (!--chunk->alive && (chunk->prev || chunk->next)) {
+		unlinkChunk(sizeClass, chunk);
+		destroyChunk(chunk);
+	}
+}
+
+Stats stats() {
+	return Counters;
+}
+
+} // namespace pool
+} // namespace base
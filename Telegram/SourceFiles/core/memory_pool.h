@@ -0,0 +1,43 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#pragma once
+
+namespace base {
+namespace pool {
+
+// Allocator for many small objects of the same lifetime, like history items.
+// Sizes up to 1kb are rounded to 16 bytes and served from 64kb chunks, freed
+// slots are put to the free list of their chunk and reused by next allocations.
+// A chunk is returned to the heap when all its objects are released, except
+// the last one of each size. Should be used from the main thread.
+void *allocate(std::size_t size);
+void release(void *data, std::size_t size);
+
+struct Stats {
+	int64 allocations = 0; // allocate() calls from the start
+	int64 alive = 0; // allocated and not yet released objects
+	int64 chunks = 0; // chunks held now
+	int64 chunksReleased = 0; // chunks returned to the heap from the start
+};
+Stats stats();
+
+} // namespace pool
+} // namespace base
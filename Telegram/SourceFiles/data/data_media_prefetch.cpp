@@ -0,0 +1,125 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#include "stdafx.h"
+#include "data/data_media_prefetch.h"
+
+#include "history/history_media_types.h"
+
+namespace Data {
+namespace {
+
+// If there were no scroll updates for that long the scroll was stopped.
+constexpr int kSpeedResetTimeoutMs = 300;
+
+// Prefetch the media that will be scrolled into the view in that time.
+constexpr int kLookAheadMs = 1000;
+constexpr int kMaxScreensAhead = 4;
+
+} // namespace
+
+void MediaPrefetcher::visibleAreaUpdated(int visibleTop, int visibleBottom) {
+	auto ms = getms();
+	if (!_lastVisibleTime || ms >= _lastVisibleTime + kSpeedResetTimeoutMs) {
+		_speed = 0.;
+	} else if (ms > _lastVisibleTime) {
+		auto speed = float64(visibleTop - _lastVisibleTop) / (ms - _lastVisibleTime);
+		_speed = (_speed + speed) / 2.;
+	}
+	_lastVisibleTop = visibleTop;
+	_lastVisibleBottom = visibleBottom;
+	_lastVisibleTime = ms;
+
+	auto screen = qMax(visibleBottom - visibleTop, 1);
+	auto ahead = snap(qRound(qAbs(_speed) * kLookAheadMs), screen, screen * kMaxScreensAhead);
+	auto behind = screen / 2;
+	if (_speed < 0) {
+		_prefetchTop = visibleTop - ahead;
+		_prefetchBottom = visibleBottom + behind;
+	} else {
+		_prefetchTop = visibleTop - behind;
+		_prefetchBottom = visibleBottom + ahead;
+	}
+}
+
+void MediaPrefetcher::add(HistoryItem *item) {
+	auto media = item ? item->getMedia() : nullptr;
+	if (!media) return;
+
+	if (media->type() == MediaTypePhoto) {
+		auto photo = static_cast<HistoryPhoto*>(media)->photo();
+		auto image = photoImage(photo);
+		if (!image->loaded()) {
+			photo->thumb->preload();
+			image->automaticPreload(item);
+			_photosAdded.insert(photo);
+		}
+	} else if (auto document = media->getDocument()) {
+		add(document);
+	}
+}
+
+void MediaPrefetcher::add(DocumentData *document) {
+	if (!document->thumb->loaded()) {
+		document->thumb->preload();
+		_documentsAdded.insert(document);
+	}
+}
+
+void MediaPrefetcher::finish() {
+	for_const (auto photo, _photos) {
+		if (!_photosAdded.contains(photo)) {
+			pause(photo);
+		}
+	}
+	for_const (auto document, _documents) {
+		if (!_documentsAdded.contains(document)) {
+			pause(document);
+		}
+	}
+	_photos = _photosAdded;
+	_documents = _documentsAdded;
+	_photosAdded.clear();
+	_documentsAdded.clear();
+}
+
+ImagePtr MediaPrefetcher::photoImage(PhotoData *photo) const {
+	return (_photoSize == PhotoSize::Medium) ? photo->medium : photo->full;
+}
+
+void MediaPrefetcher::pause(PhotoData *photo) {
+	photo->thumb->pausePreload();
+	photoImage(photo)->pausePreload();
+}
+
+void MediaPrefetcher::pause(DocumentData *document) {
+	document->thumb->pausePreload();
+}
+
+MediaPrefetcher::~MediaPrefetcher() {
+	for_const (auto photo, _photos) {
+		pause(photo);
+	}
+	for_const (auto document, _documents) {
+		pause(document);
+	}
+}
+
+} // namespace Data
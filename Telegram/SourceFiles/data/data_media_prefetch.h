@@ -0,0 +1,82 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#pragma once
+
+namespace Data {
+
+// Starts low priority loading of the media that will be scrolled into the view soon
+// and pauses it when the media goes out of the prefetch range before being displayed.
+class MediaPrefetcher {
+public:
+	enum class PhotoSize {
+		Medium,
+		Full,
+	};
+	MediaPrefetcher(PhotoSize photoSize) : _photoSize(photoSize) {
+	}
+
+	// Pass the visible area on each scroll, it is used to count the scroll speed.
+	void visibleAreaUpdated(int visibleTop, int visibleBottom);
+
+	// The range that should be passed to add() after each visibleAreaUpdated() call.
+	int prefetchTop() const {
+		return _prefetchTop;
+	}
+	int prefetchBottom() const {
+		return _prefetchBottom;
+	}
+
+	// Media in the visible area is loaded by paint with high priority, it should not be added.
+	bool visible(int top, int bottom) const {
+		return (top < _lastVisibleBottom) && (bottom > _lastVisibleTop);
+	}
+
+	// Starts only new loaders or resumes paused ones, the loaders already
+	// in the queue keep their place, so the visible media is not demoted.
+	void add(HistoryItem *item);
+	void add(DocumentData *document); // loads only the document thumbnail
+
+	// Pauses everything that was not added since the previous finish() call.
+	void finish();
+
+	~MediaPrefetcher();
+
+private:
+	ImagePtr photoImage(PhotoData *photo) const;
+	void pause(PhotoData *photo);
+	void pause(DocumentData *document);
+
+	PhotoSize _photoSize;
+
+	int _lastVisibleTop = 0;
+	int _lastVisibleBottom = 0;
+	uint64 _lastVisibleTime = 0;
+	float64 _speed = 0.; // pixels per ms, positive when scrolling down
+
+	int _prefetchTop = 0;
+	int _prefetchBottom = 0;
+
+	OrderedSet<PhotoData*> _photos, _photosAdded;
+	OrderedSet<DocumentData*> _documents, _documentsAdded;
+
+};
+
+} // namespace Data
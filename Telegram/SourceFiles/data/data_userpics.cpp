@@ -0,0 +1,97 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#include "stdafx.h"
+#include "data/data_userpics.h"
+
+namespace Data {
+namespace {
+
+constexpr int64 kUserpicsCacheSizeLimit = 16 * 1024 * 1024;
+
+struct UserpicKey {
+	StorageKey userpic;
+	int size;
+};
+inline bool operator<(const UserpicKey &a, const UserpicKey &b) {
+	return (a.userpic < b.userpic) || (a.userpic == b.userpic && a.size < b.size);
+}
+
+struct Userpic {
+	QPixmap pixmap;
+	uint64 lastUsed;
+};
+
+QMap<UserpicKey, Userpic> Userpics;
+QMap<uint64, UserpicKey> UserpicsByLastUsed;
+uint64 UserpicsLastUsed = 0;
+int64 UserpicsCacheSize = 0;
+
+int64 pixmapSize(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * 4;
+}
+
+void trimUserpics() {
+	while (UserpicsCacheSize > kUserpicsCacheSizeLimit && UserpicsByLastUsed.size() > 1) {
+		auto i = UserpicsByLastUsed.begin();
+		auto j = Userpics.find(i.value());
+		if (j != Userpics.end()) {
+			UserpicsCacheSize -= pixmapSize(j->pixmap);
+			Userpics.erase(j);
+		}
+		UserpicsByLastUsed.erase(i);
+	}
+	DEBUG_LOG(("Userpics: cache trimmed to %1 bytes in %2 pixmaps").arg(UserpicsCacheSize).arg(Userpics.size()));
+}
+
+} // namespace
+
+const QPixmap &circledUserpic(ImagePtr userpic, const StorageKey &key, int size) {
+	auto i = Userpics.find({ key, size });
+	if (i == Userpics.end()) {
+		auto realSize = size * cIntRetinaFactor();
+		auto pixmap = userpic->pixNoCache(realSize, realSize, ImagePixSmooth | ImagePixCircled);
+		if (cRetina()) pixmap.setDevicePixelRatio(cRetinaFactor());
+
+		UserpicsCacheSize += pixmapSize(pixmap);
+		i = Userpics.insert({ key, size }, { pixmap, 0 });
+	} else {
+		UserpicsByLastUsed.remove(i->lastUsed);
+	}
+	i->lastUsed = ++UserpicsLastUsed;
+	UserpicsByLastUsed.insert(i->lastUsed, i.key());
+
+	if (UserpicsCacheSize > kUserpicsCacheSizeLimit) {
+		trimUserpics();
+	}
+	return i->pixmap;
+}
+
+void clearUserpics() {
+	Userpics.clear();
+	UserpicsByLastUsed.clear();
+	UserpicsCacheSize = 0;
+}
+
+int64 userpicsCacheSize() {
+	return UserpicsCacheSize;
+}
+
+} // namespace Data
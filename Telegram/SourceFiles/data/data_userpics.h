@@ -0,0 +1,36 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop version of Telegram messaging app, see https://telegram.org
+
+Telegram Desktop is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+It is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+In addition, as a special exception, the copyright holders give permission
+to link the code of portions of this program with the OpenSSL library.
+
+Full license: https://github.com/telegramdesktop/tdesktop/blob/master/LICENSE
+Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
+*/
+#pragma once
+
+namespace Data {
+
+// Circled userpics of all sizes are kept in one cache shared by all the
+// lists that paint them, the least recently painted ones are dropped
+// when the cache grows over its memory limit.
+//
+// The key must identify the userpic image, the returned pixmap
+// is valid until the next call.
+const QPixmap &circledUserpic(ImagePtr userpic, const StorageKey &key, int size);
+
+void clearUserpics();
+int64 userpicsCacheSize(); // in bytes
+
+} // namespace Data
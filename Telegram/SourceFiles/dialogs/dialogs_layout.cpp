@@ -35,28 +35,55 @@ namespace {
 // Show all dates that are in the last 20 hours in time format.
 constexpr int kRecentlyInSeconds = 20 * 3600;
 
-void paintRowDate(Painter &p, const QDateTime &date, QRect &rectForName, bool active) {
+// Recheck the dates from the future each minute.
+constexpr int kFutureDateRecheckSeconds = 60;
+
+void prepareRowDate(const QDateTime &date, RowDateCache &cache) {
 	QDateTime now(QDateTime::currentDateTime()), lastTime(date);
 	QDate nowDate(now.date()), lastDate(lastTime.date());
-	QString dt;
+	auto nowTime = TimeId(now.toTime_t()), lastTimeId = TimeId(lastTime.toTime_t());
 	bool wasSameDay = (lastDate == nowDate);
 	bool wasRecently = qAbs(lastTime.secsTo(now)) < kRecentlyInSeconds;
+	if (lastTimeId > nowTime) {
+		cache.validTill = nowTime + kFutureDateRecheckSeconds;
+	}
 	if (wasSameDay || wasRecently) {
-		dt = lastTime.toString(cTimeFormat());
+		cache.text = lastTime.toString(cTimeFormat());
+		if (lastTimeId <= nowTime) {
+			// The time is shown till the end of the message day or while it is recent.
+			auto lastDayEnd = TimeId(QDateTime(lastDate.addDays(1)).toTime_t());
+			cache.validTill = qMax(lastDayEnd, lastTimeId + kRecentlyInSeconds);
+		}
 	} else if (lastDate.year() == nowDate.year() && lastDate.weekNumber() == nowDate.weekNumber()) {
-		dt = langDayOfWeek(lastDate);
+		cache.text = langDayOfWeek(lastDate);
+		if (lastTimeId <= nowTime) {
+			// The day of week is shown till the next week or the next year starts.
+			auto nextWeek = TimeId(QDateTime(nowDate.addDays(8 - nowDate.dayOfWeek())).toTime_t());
+			auto nextYear = TimeId(QDateTime(QDate(nowDate.year() + 1, 1, 1)).toTime_t());
+			cache.validTill = qMin(nextWeek, nextYear);
+		}
 	} else {
-		dt = lastDate.toString(qsl("d.MM.yy"));
+		cache.text = lastDate.toString(qsl("d.MM.yy"));
+		if (lastTimeId <= nowTime) {
+			cache.validTill = INT_MAX;
+		}
+	}
+	cache.date = date;
+	cache.width = st::dialogsDateFont->width(cache.text);
+}
+
+void paintRowDate(Painter &p, const QDateTime &date, QRect &rectForName, bool active, RowDateCache &cache) {
+	if (cache.date != date || cache.validTill <= myunixtime()) {
+		prepareRowDate(date, cache);
 	}
-	int32 dtWidth = st::dialogsDateFont->width(dt);
-	rectForName.setWidth(rectForName.width() - dtWidth - st::dialogsDateSkip);
+	rectForName.setWidth(rectForName.width() - cache.width - st::dialogsDateSkip);
 	p.setFont(st::dialogsDateFont);
 	p.setPen(active ? st::dialogsDateFgActive : st::dialogsDateFg);
-	p.drawText(rectForName.left() + rectForName.width() + st::dialogsDateSkip, rectForName.top() + st::msgNameFont->height - st::msgDateFont->descent, dt);
+	p.drawText(rectForName.left() + rectForName.width() + st::dialogsDateSkip, rectForName.top() + st::msgNameFont->height - st::msgDateFont->descent, cache.text);
 }
 
 template <typename PaintItemCallback>
-void paintRow(Painter &p, History *history, HistoryItem *item, Data::Draft *draft, QDateTime date, int w, bool active, bool selected, bool onlyBackground, PaintItemCallback paintItemCallback) {
+void paintRow(Painter &p, History *history, HistoryItem *item, Data::Draft *draft, QDateTime date, RowDateCache &dateCache, int w, bool active, bool selected, bool onlyBackground, PaintItemCallback paintItemCallback) {
 	QRect fullRect(0, 0, w, st::dialogsRowHeight);
 	p.fillRect(fullRect, active ? st::dialogsBgActive : (selected ? st::dialogsBgOver : st::dialogsBg));
 	if (onlyBackground) return;
@@ -75,7 +102,7 @@ void paintRow(Painter &p, History *history, HistoryItem *item, Data::Draft *draf
 
 	int texttop = st::dialogsPadding.y() + st::msgNameFont->height + st::dialogsSkip;
 	if (draft) {
-		paintRowDate(p, date, rectForName, active);
+		paintRowDate(p, date, rectForName, active, dateCache);
 
 		p.setFont(st::dialogsTextFont);
 		p.setPen(active ? st::dialogsTextFgActive : st::dialogsTextFgService);
@@ -102,7 +129,7 @@ void paintRow(Painter &p, History *history, HistoryItem *item, Data::Draft *draf
 			history->typingText.drawElided(p, nameleft, texttop, namewidth);
 		}
 	} else if (!item->isEmpty()) {
-		paintRowDate(p, date, rectForName, active);
+		paintRowDate(p, date, rectForName, active, dateCache);
 
 		paintItemCallback(nameleft, namewidth, item);
 	}
@@ -258,7 +285,7 @@ void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool sele
 	if (item && cloudDraft && unreadCount > 0) {
 		cloudDraft = nullptr; // Draw item, if draft is older.
 	}
-	paintRow(p, history, item, cloudDraft, displayDate(), w, active, selected, onlyBackground, [&p, w, active, history, unreadCount](int nameleft, int namewidth, HistoryItem *item) {
+	paintRow(p, history, item, cloudDraft, displayDate(), row->_dateCache, w, active, selected, onlyBackground, [&p, w, active, history, unreadCount](int nameleft, int namewidth, HistoryItem *item) {
 		int availableWidth = namewidth;
 		int texttop = st::dialogsPadding.y() + st::msgNameFont->height + st::dialogsSkip;
 		if (unreadCount) {
@@ -286,7 +313,7 @@ void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool sele
 void RowPainter::paint(Painter &p, const FakeRow *row, int w, bool active, bool selected, bool onlyBackground) {
 	auto item = row->item();
 	auto history = item->history();
-	paintRow(p, history, item, nullptr, item->date, w, active, selected, onlyBackground, [&p, row, active](int nameleft, int namewidth, HistoryItem *item) {
+	paintRow(p, history, item, nullptr, item->date, row->_dateCache, w, active, selected, onlyBackground, [&p, row, active](int nameleft, int namewidth, HistoryItem *item) {
 		int lastWidth = namewidth, texttop = st::dialogsPadding.y() + st::msgNameFont->height + st::dialogsSkip;
 		item->drawInDialog(p, QRect(nameleft, texttop, lastWidth, st::dialogsTextFont->height), active, row->_cacheFor, row->_cache);
 	});
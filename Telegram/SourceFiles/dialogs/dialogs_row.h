@@ -30,6 +30,15 @@ namespace Layout {
 class RowPainter;
 } // namespace Layout
 
+// The row date text depends on the current time, so we cache
+// it until the moment the date should be displayed differently.
+struct RowDateCache {
+	QDateTime date;
+	QString text;
+	int width = 0;
+	TimeId validTill = 0;
+};
+
 class List;
 class Row {
 public:
@@ -50,10 +59,12 @@ public:
 
 private:
 	friend class List;
+	friend class Layout::RowPainter;
 
 	History *_history;
 	Row *_prev, *_next;
 	int _pos;
+	mutable RowDateCache _dateCache;
 
 };
 
@@ -71,6 +82,7 @@ private:
 	HistoryItem *_item;
 	mutable const HistoryItem *_cacheFor = nullptr;
 	mutable Text _cache;
+	mutable RowDateCache _dateCache;
 
 };
 
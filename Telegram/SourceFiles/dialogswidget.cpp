@@ -38,6 +38,13 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "localstorage.h"
 #include "apiwrap.h"
 
+namespace {
+
+constexpr int kDialogsSlicePartSize = 20;
+constexpr int kDialogsSliceBudgetMs = 8; // add more parts while we fit in one frame
+
+} // namespace
+
 DialogsInner::DialogsInner(QWidget *parent, MainWidget *main) : SplittedWidget(parent)
 , dialogs(std_::make_unique<Dialogs::IndexedList>(Dialogs::SortMode::Date))
 , contactsNoDialogs(std_::make_unique<Dialogs::IndexedList>(Dialogs::SortMode::Name))
@@ -780,7 +787,7 @@ void DialogsInner::onFilterUpdate(QString newFilter, bool force) {
 	if (newFilter != _filter || force) {
 		QStringList f;
 		if (!newFilter.isEmpty()) {
-			QStringList filterList = newFilter.split(cWordSplit(), QString::SkipEmptyParts);
+			QStringList filterList = textSplitWords(newFilter);
 			int l = filterList.size();
 
 			f.reserve(l);
@@ -1947,23 +1954,22 @@ void DialogsWidget::unreadCountsReceived(const QVector<MTPDialog> &dialogs) {
 void DialogsWidget::dialogsReceived(const MTPmessages_Dialogs &dialogs, mtpRequestId req) {
 	if (_dialogsRequest != req) return;
 
-	const QVector<MTPDialog> *dialogsList = 0;
-	const QVector<MTPMessage> *messagesList = 0;
+	clearDialogsSlice();
 	switch (dialogs.type()) {
 	case mtpc_messages_dialogs: {
 		const auto &data(dialogs.c_messages_dialogs());
-		App::feedUsers(data.vusers);
-		App::feedChats(data.vchats);
-		messagesList = &data.vmessages.c_vector().v;
-		dialogsList = &data.vdialogs.c_vector().v;
+		_dialogsSlice.users = data.vusers.c_vector().v;
+		_dialogsSlice.chats = data.vchats.c_vector().v;
+		_dialogsSlice.messages = data.vmessages.c_vector().v;
+		_dialogsSlice.dialogs = data.vdialogs.c_vector().v;
 		_dialogsFull = true;
 	} break;
 	case mtpc_messages_dialogsSlice: {
 		const auto &data(dialogs.c_messages_dialogsSlice());
-		App::feedUsers(data.vusers);
-		App::feedChats(data.vchats);
-		messagesList = &data.vmessages.c_vector().v;
-		dialogsList = &data.vdialogs.c_vector().v;
+		_dialogsSlice.users = data.vusers.c_vector().v;
+		_dialogsSlice.chats = data.vchats.c_vector().v;
+		_dialogsSlice.messages = data.vmessages.c_vector().v;
+		_dialogsSlice.dialogs = data.vdialogs.c_vector().v;
 	} break;
 	}
 
@@ -1971,55 +1977,129 @@ void DialogsWidget::dialogsReceived(const MTPmessages_Dialogs &dialogs, mtpReque
 		_contactsRequest = MTP::send(MTPcontacts_GetContacts(MTP_string("")), rpcDone(&DialogsWidget::contactsReceived), rpcFail(&DialogsWidget::contactsFailed));
 	}
 
-	if (messagesList) {
-		App::feedMsgs(*messagesList, NewMessageLast);
+	// Top messages are fed in the order of their dialogs, so that
+	// the rows on the top of the list are ready to be shown first.
+	auto &slice = _dialogsSlice;
+	QHash<PeerId, int> dialogIndices;
+	dialogIndices.reserve(slice.dialogs.size());
+	for (int i = 0, count = slice.dialogs.size(); i != count; ++i) {
+		auto &dialog = slice.dialogs.at(i);
+		if (dialog.type() == mtpc_dialog) {
+			if (auto peer = peerFromMTP(dialog.c_dialog().vpeer)) {
+				dialogIndices.insert(peer, i);
+			}
+		}
 	}
-	if (dialogsList) {
-		unreadCountsReceived(*dialogsList);
-		_inner.dialogsReceived(*dialogsList);
-		onListScroll();
+	QVector<QPair<int, int>> order;
+	order.reserve(slice.messages.size());
+	for (int i = 0, count = slice.messages.size(); i != count; ++i) {
+		auto dialogIndex = dialogIndices.value(peerFromMessage(slice.messages.at(i)), slice.dialogs.size());
+		order.push_back(qMakePair(dialogIndex, i));
+	}
+	std::sort(order.begin(), order.end());
+
+	auto messages = base::take(slice.messages);
+	slice.messages.reserve(order.size());
+	slice.messagesDialogIndices.reserve(order.size());
+	for_const (auto &entry, order) {
+		slice.messages.push_back(messages.at(entry.second));
+		slice.messagesDialogIndices.push_back(entry.first);
+	}
+
+	slice.received = true;
+	onDialogsSliceAdd();
+}
+
+void DialogsWidget::onDialogsSliceAdd() {
+	auto &slice = _dialogsSlice;
+	if (!slice.received || !_dialogsRequest) {
+		return;
+	}
+
+	auto dialogsAddedBefore = slice.dialogsAdded;
+	auto ms = getms(true);
+	do {
+		if (slice.usersAdded < slice.users.size()) {
+			auto part = slice.users.mid(slice.usersAdded, kDialogsSlicePartSize);
+			slice.usersAdded += part.size();
+			App::feedUsers(MTP_vector<MTPUser>(part));
+		} else if (slice.chatsAdded < slice.chats.size()) {
+			auto part = slice.chats.mid(slice.chatsAdded, kDialogsSlicePartSize);
+			slice.chatsAdded += part.size();
+			App::feedChats(MTP_vector<MTPChat>(part));
+		} else {
+			auto part = slice.dialogs.mid(slice.dialogsAdded, kDialogsSlicePartSize);
+			slice.dialogsAdded += part.size();
+			auto lastPart = (slice.dialogsAdded == slice.dialogs.size());
+
+			auto messagesTill = slice.messagesAdded;
+			while (messagesTill < slice.messages.size() && (lastPart || slice.messagesDialogIndices.at(messagesTill) < slice.dialogsAdded)) {
+				++messagesTill;
+			}
+			if (messagesTill > slice.messagesAdded) {
+				App::feedMsgs(slice.messages.mid(slice.messagesAdded, messagesTill - slice.messagesAdded), NewMessageLast);
+				slice.messagesAdded = messagesTill;
+			}
 
-		TimeId lastDate = 0;
-		PeerId lastPeer = 0;
-		MsgId lastMsgId = 0;
-		for (int i = dialogsList->size(); i > 0;) {
-			auto &dialog = dialogsList->at(--i);
-			if (dialog.type() != mtpc_dialog) {
-				continue;
+			unreadCountsReceived(part);
+			_inner.dialogsReceived(part);
+			onListScroll();
+			if (lastPart) {
+				break;
 			}
+		}
+	} while (getms(true) - ms < kDialogsSliceBudgetMs);
 
-			if (auto peer = peerFromMTP(dialog.c_dialog().vpeer)) {
-				if (!lastPeer) lastPeer = peer;
-				if (auto msgId = dialog.c_dialog().vtop_message.v) {
-					if (!lastMsgId) lastMsgId = msgId;
-					for (int j = messagesList->size(); j > 0;) {
-						auto &message = messagesList->at(--j);
-						if (idFromMessage(message) == msgId && peerFromMessage(message) == peer) {
-							if (auto date = dateFromMessage(message)) {
-								lastDate = date;
-							}
-							break;
+	auto finished = (slice.dialogsAdded == slice.dialogs.size() && slice.messagesAdded == slice.messages.size());
+	DEBUG_LOG(("Dialogs: added %1 dialogs (%2 of %3) in %4 ms").arg(slice.dialogsAdded - dialogsAddedBefore).arg(slice.dialogsAdded).arg(slice.dialogs.size()).arg(getms(true) - ms));
+	if (!finished) {
+		QTimer::singleShot(0, this, SLOT(onDialogsSliceAdd()));
+		return;
+	}
+
+	TimeId lastDate = 0;
+	PeerId lastPeer = 0;
+	MsgId lastMsgId = 0;
+	for (int i = slice.dialogs.size(); i > 0;) {
+		auto &dialog = slice.dialogs.at(--i);
+		if (dialog.type() != mtpc_dialog) {
+			continue;
+		}
+
+		if (auto peer = peerFromMTP(dialog.c_dialog().vpeer)) {
+			if (!lastPeer) lastPeer = peer;
+			if (auto msgId = dialog.c_dialog().vtop_message.v) {
+				if (!lastMsgId) lastMsgId = msgId;
+				for (int j = slice.messages.size(); j > 0;) {
+					auto &message = slice.messages.at(--j);
+					if (idFromMessage(message) == msgId && peerFromMessage(message) == peer) {
+						if (auto date = dateFromMessage(message)) {
+							lastDate = date;
 						}
+						break;
 					}
-					if (lastDate) break;
 				}
+				if (lastDate) break;
 			}
 		}
-		if (lastDate) {
-			_dialogsOffsetDate = lastDate;
-			_dialogsOffsetId = lastMsgId;
-			_dialogsOffsetPeer = App::peer(lastPeer);
-		} else {
-			_dialogsFull = true;
-		}
+	}
+	if (lastDate) {
+		_dialogsOffsetDate = lastDate;
+		_dialogsOffsetId = lastMsgId;
+		_dialogsOffsetPeer = App::peer(lastPeer);
 	} else {
 		_dialogsFull = true;
 	}
 
+	clearDialogsSlice();
 	_dialogsRequest = 0;
 	loadDialogs();
 }
 
+void DialogsWidget::clearDialogsSlice() {
+	_dialogsSlice = DialogsSlice();
+}
+
 bool DialogsWidget::dialogsFailed(const RPCError &error, mtpRequestId req) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
@@ -2148,7 +2228,7 @@ void DialogsWidget::loadDialogs() {
 	}
 
 	int32 loadCount = _dialogsOffsetDate ? DialogsPerPage : DialogsFirstLoad;
-	_dialogsRequest = MTP::send(MTPmessages_GetDialogs(MTP_int(_dialogsOffsetDate), MTP_int(_dialogsOffsetId), _dialogsOffsetPeer ? _dialogsOffsetPeer->input : MTP_inputPeerEmpty(), MTP_int(loadCount)), rpcDone(&DialogsWidget::dialogsReceived), rpcFail(&DialogsWidget::dialogsFailed));
+	_dialogsRequest = MTP::send(MTPmessages_GetDialogs(MTP_int(_dialogsOffsetDate), MTP_int(_dialogsOffsetId), _dialogsOffsetPeer ? _dialogsOffsetPeer->input : MTP_inputPeerEmpty(), MTP_int(loadCount)), rpcParseAnywhere(rpcDone(&DialogsWidget::dialogsReceived)), rpcFail(&DialogsWidget::dialogsFailed));
 }
 
 void DialogsWidget::contactsReceived(const MTPcontacts_Contacts &contacts) {
@@ -2520,6 +2600,7 @@ void DialogsWidget::paintEvent(QPaintEvent *e) {
 }
 
 void DialogsWidget::destroyData() {
+	clearDialogsSlice();
 	_inner.destroyData();
 }
 
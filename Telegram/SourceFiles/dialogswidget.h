@@ -318,6 +318,10 @@ public slots:
 
 	void onChooseByDrag();
 
+private slots:
+
+	void onDialogsSliceAdd();
+
 private:
 
 	bool _dragInScroll, _dragForward;
@@ -335,6 +339,23 @@ private:
 	PeerData *_dialogsOffsetPeer;
 	mtpRequestId _dialogsRequest, _contactsRequest;
 
+	// Received dialogs are added in parts in onDialogsSliceAdd(),
+	// the request is finished when the last part is added.
+	struct DialogsSlice {
+		QVector<MTPUser> users;
+		QVector<MTPChat> chats;
+		QVector<MTPMessage> messages; // sorted by the dialog they belong to
+		QVector<int> messagesDialogIndices;
+		QVector<MTPDialog> dialogs;
+		int usersAdded = 0;
+		int chatsAdded = 0;
+		int messagesAdded = 0;
+		int dialogsAdded = 0;
+		bool received = false;
+	};
+	DialogsSlice _dialogsSlice;
+	void clearDialogsSlice();
+
 	FlatInput _filter;
 	ChildWidget<Ui::RoundButton> _newGroup;
 	IconedButton _addContact, _cancelSearch;
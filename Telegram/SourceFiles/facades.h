@@ -212,6 +212,7 @@ enum Layout {
 namespace DebugLogging {
 enum Flags {
 	FileLoaderFlag = 0x00000001,
+	MemoryFlag = 0x00000002,
 };
 } // namespace DebugLogging
 
@@ -382,4 +383,8 @@ inline bool FileLoader() {
 	return (Global::DebugLoggingFlags() & FileLoaderFlag) != 0;
 }
 
+inline bool Memory() {
+	return (Global::DebugLoggingFlags() & MemoryFlag) != 0;
+}
+
 } // namespace DebugLogging
@@ -21,6 +21,8 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "stdafx.h"
 #include "fileuploader.h"
 
+#include "localstorage.h"
+
 FileUploader::FileUploader() : sentSize(0) {
 	memset(sentSizes, 0, sizeof(sentSizes));
 	nextTimer.setSingleShot(true);
@@ -47,7 +49,9 @@ void FileUploader::uploadMedia(const FullMsgId &msgId, const ReadyLocalMedia &me
 			document->setLocation(FileLocation(StorageFilePartial, media.file));
 		}
 	}
-	queue.insert(msgId, File(media));
+	File upload(media);
+	resumePartial(upload);
+	queue.insert(msgId, upload);
 	sendNext();
 }
 
@@ -70,12 +74,34 @@ void FileUploader::upload(const FullMsgId &msgId, const FileLoadResultPtr &file)
 			document->setLocation(FileLocation(StorageFilePartial, file->filepath));
 		}
 	}
-	queue.insert(msgId, File(file));
+	File upload(file);
+	resumePartial(upload);
+	queue.insert(msgId, upload);
 	sendNext();
 }
 
-void FileUploader::currentFailed() {
-	Queue::iterator j = queue.find(uploading);
+void FileUploader::fileReady(const FullMsgId &msgId, File &file) {
+	bool silent = file.file && file.file->to.silent;
+	if (file.type() == PreparePhoto) {
+		emit photoReady(msgId, silent, MTP_inputFile(MTP_long(file.id()), MTP_int(file.partsCount), MTP_string(file.filename()), MTP_bytes(file.file ? file.file->filemd5 : file.media.jpeg_md5)));
+	} else if (file.type() == PrepareDocument || file.type() == PrepareAudio) {
+		QByteArray docMd5(32, Qt::Uninitialized);
+		hashMd5Hex(file.md5Hash.result(), docMd5.data());
+
+		MTPInputFile doc = (file.docSize > UseBigFilesFrom) ? MTP_inputFileBig(MTP_long(file.docUploadId), MTP_int(file.docPartsCount), MTP_string(file.filename())) : MTP_inputFile(MTP_long(file.docUploadId), MTP_int(file.docPartsCount), MTP_string(file.filename()), MTP_bytes(docMd5));
+		if (file.partsCount) {
+			emit thumbDocumentReady(msgId, silent, doc, MTP_inputFile(MTP_long(file.thumbId()), MTP_int(file.partsCount), MTP_string(file.file ? file.file->thumbname : (qsl("thumb.") + file.media.thumbExt)), MTP_bytes(file.file ? file.file->thumbmd5 : file.media.jpeg_md5)));
+		} else {
+			emit documentReady(msgId, silent, doc);
+		}
+	}
+	if (file.docResumable()) {
+		Local::clearPartialUpload(file.docPath());
+	}
+}
+
+void FileUploader::fileFailed(FullMsgId msgId) {
+	Queue::iterator j = queue.find(msgId);
 	if (j != queue.end()) {
 		if (j->type() == PreparePhoto) {
 			emit photoFailed(j.key());
@@ -86,29 +112,98 @@ void FileUploader::currentFailed() {
 			}
 			emit documentFailed(j.key());
 		}
-		queue.erase(j);
+		if (j->docResumable()) {
+			Local::clearPartialUpload(j->docPath());
+		}
+		queue.remove(msgId);
 	}
 
-	requestsSent.clear();
-	docRequestsSent.clear();
-	dcMap.clear();
-	uploading = FullMsgId();
-	sentSize = 0;
-	for (int i = 0; i < MTPUploadSessionsCount; ++i) {
-		sentSizes[i] = 0;
+	// Forget the parts of this file still in flight, acks for them are ignored.
+	for (auto i = sentRequests.begin(); i != sentRequests.end();) {
+		if (i->msgId == msgId) {
+			requestsSent.remove(i.key());
+			docRequestsSent.remove(i.key());
+			sentSize -= i->size;
+			sentSizes[i->dc] -= i->size;
+			i = sentRequests.erase(i);
+		} else {
+			++i;
+		}
 	}
 
 	sendNext();
 }
 
+void FileUploader::resumePartial(File &file) {
+	if (!file.docResumable()) return;
+
+	file.docModified = QFileInfo(file.docPath()).lastModified();
+
+	Local::PartialUpload partial = Local::readPartialUpload(file.docPath());
+	if (!partial.fileId || partial.partSize != file.docPartSize || partial.partsUploaded <= 0 || partial.partsUploaded >= file.docPartsCount) {
+		return;
+	}
+	DEBUG_LOG(("Upload Info: resuming upload of '%1' from part %2").arg(file.docPath()).arg(partial.partsUploaded));
+	file.docUploadId = partial.fileId;
+	file.docSentParts = partial.partsUploaded;
+}
+
+void FileUploader::savePartial(const FullMsgId &msgId, const File &file) {
+	// Every part before the first one still in flight was acked by the server.
+	int32 uploaded = file.docSentParts;
+	for (QMap<mtpRequestId, int32>::const_iterator i = docRequestsSent.cbegin(), e = docRequestsSent.cend(); i != e; ++i) {
+		if (i.value() < uploaded && sentRequests.value(i.key()).msgId == msgId) {
+			uploaded = i.value();
+		}
+	}
+	if (uploaded <= 0) return;
+
+	Local::PartialUpload partial;
+	partial.fileId = file.docUploadId;
+	partial.size = file.docSize;
+	partial.modified = file.docModified;
+	partial.partSize = file.docPartSize;
+	partial.partsUploaded = uploaded;
+	partial.updated = QDateTime::currentDateTime();
+	Local::writePartialUpload(file.docPath(), partial);
+}
+
 void FileUploader::killSessions() {
 	for (int i = 0; i < MTPUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uplDcId(i));
 	}
 }
 
+void FileUploader::ackReceived(uint64 latency) {
+	ackLatency = ackLatency ? ((ackLatency * 3 + latency) / 4) : latency;
+	if (ackLatency < UploadGoodAckLatency) {
+		sentSizeLimit = qMin(sentSizeLimit + UploadFileParallelSizeStep, uint32(MaxUploadFileParallelSize));
+	} else if (ackLatency > UploadBadAckLatency) {
+		sentSizeLimit = qMax(sentSizeLimit - sentSizeLimit / 4, uint32(MinUploadFileParallelSize));
+	}
+}
+
+FileUploader::Queue::iterator FileUploader::chooseNextFile() {
+	// Round-robin between the first files that still have parts to send,
+	// so that a small photo queued after a large document is not waiting for it.
+	Queue::iterator first = queue.end(), next = queue.end();
+	int32 candidates = 0;
+	for (Queue::iterator i = queue.begin(), e = queue.end(); i != e && candidates < UploadFilesInParallel; ++i) {
+		if (i->allPartsSent()) continue;
+
+		++candidates;
+		if (first == e) {
+			first = i;
+		}
+		if (next == e && lastSentFile < i.key()) {
+			next = i;
+		}
+	}
+	return (next != queue.end()) ? next : first;
+}
+
 void FileUploader::sendNext() {
-	if (sentSize >= MaxUploadFileParallelSize || _paused.msg) return;
+	if (_paused.msg) return;
 
 	bool killing = killSessionsTimer.isActive();
 	if (queue.isEmpty()) {
@@ -121,13 +216,29 @@ void FileUploader::sendNext() {
 	if (killing) {
 		killSessionsTimer.stop();
 	}
-	Queue::iterator i = uploading.msg ? queue.find(uploading) : queue.begin();
-	if (!uploading.msg) {
-		uploading = i.key();
-	} else if (i == queue.end()) {
-		i = queue.begin();
-		uploading = i.key();
+	for (Queue::iterator i = queue.begin(), e = queue.end(); i != e; ++i) {
+		if (i->ready()) {
+			FullMsgId msgId = i.key();
+			File file = i.value();
+			queue.erase(i);
+			fileReady(msgId, file);
+			return sendNext();
+		}
+	}
+
+	while (sentSize < sentSizeLimit) {
+		Queue::iterator i = chooseNextFile();
+		if (i == queue.end()) {
+			break;
+		}
+		if (!sendPart(i)) {
+			return; // the file has failed and sendNext() was already called
+		}
 	}
+	nextTimer.start(UploadRequestInterval);
+}
+
+bool FileUploader::sendPart(Queue::iterator i) {
 	int todc = 0;
 	for (int dc = 1; dc < MTPUploadSessionsCount; ++dc) {
 		if (sentSizes[dc] < sentSizes[todc]) {
@@ -135,40 +246,23 @@ void FileUploader::sendNext() {
 		}
 	}
 
-	UploadFileParts &parts(i->file ? (i->type() == PreparePhoto ? i->file->fileparts : i->file->thumbparts) : i->media.parts);
+	SentRequest request;
+	request.msgId = i.key();
+	request.dc = todc;
+	request.sent = getms();
+
+	UploadFileParts &parts(i->parts());
 	uint64 partsOfId(i->file ? (i->type() == PreparePhoto ? i->file->id : i->file->thumbId) : i->media.thumbId);
+	mtpRequestId requestId;
 	if (parts.isEmpty()) {
-		if (i->docSentParts >= i->docPartsCount) {
-			if (requestsSent.isEmpty() && docRequestsSent.isEmpty()) {
-				bool silent = i->file && i->file->to.silent;
-				if (i->type() == PreparePhoto) {
-					emit photoReady(uploading, silent, MTP_inputFile(MTP_long(i->id()), MTP_int(i->partsCount), MTP_string(i->filename()), MTP_bytes(i->file ? i->file->filemd5 : i->media.jpeg_md5)));
-				} else if (i->type() == PrepareDocument || i->type() == PrepareAudio) {
-					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(i->md5Hash.result(), docMd5.data());
-
-					MTPInputFile doc = (i->docSize > UseBigFilesFrom) ? MTP_inputFileBig(MTP_long(i->id()), MTP_int(i->docPartsCount), MTP_string(i->filename())) : MTP_inputFile(MTP_long(i->id()), MTP_int(i->docPartsCount), MTP_string(i->filename()), MTP_bytes(docMd5));
-					if (i->partsCount) {
-						emit thumbDocumentReady(uploading, silent, doc, MTP_inputFile(MTP_long(i->thumbId()), MTP_int(i->partsCount), MTP_string(i->file ? i->file->thumbname : (qsl("thumb.") + i->media.thumbExt)), MTP_bytes(i->file ? i->file->thumbmd5 : i->media.jpeg_md5)));
-					} else {
-						emit documentReady(uploading, silent, doc);
-					}
-				}
-				queue.remove(uploading);
-				uploading = FullMsgId();
-				sendNext();
-			}
-			return;
-		}
-
 		QByteArray &content(i->file ? i->file->content : i->media.data);
 		QByteArray toSend;
 		if (content.isEmpty()) {
 			if (!i->docFile) {
 				i->docFile.reset(new QFile(i->file ? i->file->filepath : i->media.file));
-				if (!i->docFile->open(QIODevice::ReadOnly)) {
-					currentFailed();
-					return;
+				if (!i->docFile->open(QIODevice::ReadOnly) || !i->docFile->seek(qint64(i->docSentParts) * i->docPartSize)) {
+					fileFailed(i.key());
+					return false;
 				}
 			}
 			toSend = i->docFile->read(i->docPartSize);
@@ -182,39 +276,43 @@ void FileUploader::sendNext() {
 			}
 		}
 		if (toSend.size() > i->docPartSize || (toSend.size() < i->docPartSize && i->docSentParts + 1 != i->docPartsCount)) {
-			currentFailed();
-			return;
+			fileFailed(i.key());
+			return false;
 		}
-		mtpRequestId requestId;
 		if (i->docSize > UseBigFilesFrom) {
-			requestId = MTP::send(MTPupload_SaveBigFilePart(MTP_long(i->id()), MTP_int(i->docSentParts), MTP_int(i->docPartsCount), MTP_bytes(toSend)), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
+			requestId = MTP::send(MTPupload_SaveBigFilePart(MTP_long(i->docUploadId), MTP_int(i->docSentParts), MTP_int(i->docPartsCount), MTP_bytes(toSend)), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
 		} else {
-			requestId = MTP::send(MTPupload_SaveFilePart(MTP_long(i->id()), MTP_int(i->docSentParts), MTP_bytes(toSend)), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
+			requestId = MTP::send(MTPupload_SaveFilePart(MTP_long(i->docUploadId), MTP_int(i->docSentParts), MTP_bytes(toSend)), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
 		}
 		docRequestsSent.insert(requestId, i->docSentParts);
-		dcMap.insert(requestId, todc);
-		sentSize += i->docPartSize;
-		sentSizes[todc] += i->docPartSize;
+		request.size = i->docPartSize;
 
 		i->docSentParts++;
+		i->docPartsInFlight++;
 	} else {
 		UploadFileParts::iterator part = parts.begin();
 
-		mtpRequestId requestId = MTP::send(MTPupload_SaveFilePart(MTP_long(partsOfId), MTP_int(part.key()), MTP_bytes(part.value())), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
+		requestId = MTP::send(MTPupload_SaveFilePart(MTP_long(partsOfId), MTP_int(part.key()), MTP_bytes(part.value())), rpcDone(&FileUploader::partLoaded), rpcFail(&FileUploader::partFailed), MTP::uplDcId(todc));
 		requestsSent.insert(requestId, part.value());
-		dcMap.insert(requestId, todc);
-		sentSize += part.value().size();
-		sentSizes[todc] += part.value().size();
+		request.size = part.value().size();
 
 		parts.erase(part);
+		i->partsInFlight++;
 	}
-	nextTimer.start(UploadRequestInterval);
+	sentRequests.insert(requestId, request);
+	sentSize += request.size;
+	sentSizes[todc] += request.size;
+
+	i->started = true;
+	lastSentFile = i.key();
+	return true;
 }
 
 void FileUploader::cancel(const FullMsgId &msgId) {
 	uploaded.remove(msgId);
-	if (uploading == msgId) {
-		currentFailed();
+	Queue::const_iterator i = queue.constFind(msgId);
+	if (i != queue.cend() && i->started) {
+		fileFailed(msgId);
 	} else {
 		queue.remove(msgId);
 	}
@@ -235,15 +333,12 @@ void FileUploader::confirm(const FullMsgId &msgId) {
 void FileUploader::clear() {
 	uploaded.clear();
 	queue.clear();
-	for (QMap<mtpRequestId, QByteArray>::const_iterator i = requestsSent.cbegin(), e = requestsSent.cend(); i != e; ++i) {
+	for (QMap<mtpRequestId, SentRequest>::const_iterator i = sentRequests.cbegin(), e = sentRequests.cend(); i != e; ++i) {
 		MTP::cancel(i.key());
 	}
 	requestsSent.clear();
-	for (QMap<mtpRequestId, int32>::const_iterator i = docRequestsSent.cbegin(), e = docRequestsSent.cend(); i != e; ++i) {
-		MTP::cancel(i.key());
-	}
 	docRequestsSent.clear();
-	dcMap.clear();
+	sentRequests.clear();
 	sentSize = 0;
 	for (int32 i = 0; i < MTPUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uplDcId(i));
@@ -253,53 +348,50 @@ void FileUploader::clear() {
 }
 
 void FileUploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
-	QMap<mtpRequestId, int32>::iterator j = docRequestsSent.end();
-	QMap<mtpRequestId, QByteArray>::iterator i = requestsSent.find(requestId);
-	if (i == requestsSent.cend()) {
-		j = docRequestsSent.find(requestId);
+	QMap<mtpRequestId, SentRequest>::iterator j = sentRequests.find(requestId);
+	if (j == sentRequests.end()) { // part of a cancelled or failed file
+		sendNext();
+		return;
+	}
+	SentRequest request = j.value();
+	if (mtpIsFalse(result)) { // failed to upload this file
+		fileFailed(request.msgId);
+		return;
 	}
-	if (i != requestsSent.cend() || j != docRequestsSent.cend()) {
-		if (mtpIsFalse(result)) { // failed to upload current file
-			currentFailed();
-			return;
+	sentRequests.erase(j);
+	bool docPart = !requestsSent.remove(requestId);
+	docRequestsSent.remove(requestId);
+	sentSize -= request.size;
+	sentSizes[request.dc] -= request.size;
+	ackReceived(getms() - request.sent);
+
+	Queue::iterator k = queue.find(request.msgId);
+	if (k != queue.end()) {
+		if (docPart) {
+			--k->docPartsInFlight;
 		} else {
-			QMap<mtpRequestId, int32>::iterator dcIt = dcMap.find(requestId);
-			if (dcIt == dcMap.cend()) { // must not happen
-				currentFailed();
-				return;
+			--k->partsInFlight;
+		}
+		if (k->type() == PreparePhoto) {
+			k->fileSentSize += request.size;
+			PhotoData *photo = App::photo(k->id());
+			if (photo->uploading() && k->file) {
+				photo->uploadingData->size = k->file->partssize;
+				photo->uploadingData->offset = k->fileSentSize;
 			}
-			int32 dc = dcIt.value();
-			dcMap.erase(dcIt);
-
-			int32 sentPartSize = 0;
-			Queue::const_iterator k = queue.constFind(uploading);
-			if (i != requestsSent.cend()) {
-				sentPartSize = i.value().size();
-				requestsSent.erase(i);
-			} else {
-				sentPartSize = k->docPartSize;
-				docRequestsSent.erase(j);
+			emit photoProgress(k.key());
+		} else if (k->type() == PrepareDocument || k->type() == PrepareAudio) {
+			if (docPart && k->docResumable()) {
+				savePartial(k.key(), k.value());
 			}
-			sentSize -= sentPartSize;
-			sentSizes[dc] -= sentPartSize;
-			if (k->type() == PreparePhoto) {
-				k->fileSentSize += sentPartSize;
-				PhotoData *photo = App::photo(k->id());
-				if (photo->uploading() && k->file) {
-					photo->uploadingData->size = k->file->partssize;
-					photo->uploadingData->offset = k->fileSentSize;
-				}
-				emit photoProgress(k.key());
-			} else if (k->type() == PrepareDocument || k->type() == PrepareAudio) {
-				DocumentData *doc = App::document(k->id());
-				if (doc->uploading()) {
-					doc->uploadOffset = (k->docSentParts - docRequestsSent.size()) * k->docPartSize;
-					if (doc->uploadOffset > doc->size) {
-						doc->uploadOffset = doc->size;
-					}
+			DocumentData *doc = App::document(k->id());
+			if (doc->uploading()) {
+				doc->uploadOffset = (k->docSentParts - k->docPartsInFlight) * k->docPartSize;
+				if (doc->uploadOffset > doc->size) {
+					doc->uploadOffset = doc->size;
 				}
-				emit documentProgress(k.key());
 			}
+			emit documentProgress(k.key());
 		}
 	}
 
@@ -309,9 +401,11 @@ void FileUploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 bool FileUploader::partFailed(const RPCError &error, mtpRequestId requestId) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
-	if (requestsSent.constFind(requestId) != requestsSent.cend() || docRequestsSent.constFind(requestId) != docRequestsSent.cend()) { // failed to upload current file
-		currentFailed();
+	QMap<mtpRequestId, SentRequest>::const_iterator i = sentRequests.constFind(requestId);
+	if (i != sentRequests.cend()) { // failed to upload this file
+		fileFailed(i->msgId);
+	} else {
+		sendNext();
 	}
-	sendNext();
 	return true;
 }
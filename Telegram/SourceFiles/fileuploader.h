@@ -62,6 +62,7 @@ private:
 
 	struct File {
 		File(const ReadyLocalMedia &media) : media(media), docSentParts(0) {
+			docUploadId = id();
 			partsCount = media.parts.size();
 			if (type() == PrepareDocument || type() == PrepareAudio) {
 				setDocSize(media.file.isEmpty() ? media.data.size() : media.filesize);
@@ -70,6 +71,7 @@ private:
 			}
 		}
 		File(const FileLoadResultPtr &file) : file(file), docSentParts(0) {
+			docUploadId = id();
 			partsCount = (type() == PreparePhoto) ? file->fileparts.size() : file->thumbparts.size();
 			if (type() == PrepareDocument || type() == PrepareAudio) {
 				setDocSize(file->filesize);
@@ -100,7 +102,11 @@ private:
 		FileLoadResultPtr file;
 		ReadyLocalMedia media;
 		int32 partsCount;
-		mutable int32 fileSentSize;
+		mutable int32 fileSentSize = 0;
+
+		bool started = false;
+		int32 partsInFlight = 0;
+		int32 docPartsInFlight = 0;
 
 		uint64 id() const {
 			return file ? file->id : media.id;
@@ -114,10 +120,31 @@ private:
 		const QString &filename() const {
 			return file ? file->filename : media.filename;
 		}
+		UploadFileParts &parts() {
+			return file ? (type() == PreparePhoto ? file->fileparts : file->thumbparts) : media.parts;
+		}
+		bool allPartsSent() const {
+			const UploadFileParts &left(file ? (type() == PreparePhoto ? file->fileparts : file->thumbparts) : media.parts);
+			return left.isEmpty() && (docSentParts >= docPartsCount);
+		}
+		bool ready() const {
+			return allPartsSent() && !partsInFlight && !docPartsInFlight;
+		}
+		QString docPath() const {
+			if (file) {
+				return file->content.isEmpty() ? file->filepath : QString();
+			}
+			return media.data.isEmpty() ? media.file : QString();
+		}
+		bool docResumable() const {
+			return (docSize > UseBigFilesFrom) && !docPath().isEmpty();
+		}
 
 		HashMd5 md5Hash;
 
 		QSharedPointer<QFile> docFile;
+		uint64 docUploadId = 0; // differs from id() when continuing an interrupted upload
+		QDateTime docModified;
 		int32 docSentParts;
 		int32 docSize;
 		int32 docPartSize;
@@ -128,15 +155,33 @@ private:
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
 
-	void currentFailed();
+	Queue::iterator chooseNextFile();
+	bool sendPart(Queue::iterator i);
+	void fileReady(const FullMsgId &msgId, File &file);
+	void fileFailed(FullMsgId msgId);
+	void ackReceived(uint64 latency);
+
+	void resumePartial(File &file);
+	void savePartial(const FullMsgId &msgId, const File &file);
+
+	struct SentRequest {
+		FullMsgId msgId;
+		int32 dc = 0;
+		int32 size = 0;
+		uint64 sent = 0;
+	};
 
 	QMap<mtpRequestId, QByteArray> requestsSent;
 	QMap<mtpRequestId, int32> docRequestsSent;
-	QMap<mtpRequestId, int32> dcMap;
+	QMap<mtpRequestId, SentRequest> sentRequests;
 	uint32 sentSize;
 	uint32 sentSizes[MTPUploadSessionsCount];
 
-	FullMsgId uploading, _paused;
+	// Bytes allowed in flight, adjusted by the measured ack latency.
+	uint32 sentSizeLimit = StartUploadFileParallelSize;
+	uint64 ackLatency = 0;
+
+	FullMsgId lastSentFile, _paused;
 	Queue queue;
 	Queue uploaded;
 	QTimer nextTimer, killSessionsTimer;
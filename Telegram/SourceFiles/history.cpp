@@ -31,6 +31,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "localstorage.h"
 #include "window/top_bar_widget.h"
 #include "observer_peer.h"
+#include "media/media_audio.h"
 
 namespace {
 
@@ -44,6 +45,10 @@ constexpr int kStatusShowClientsideChooseLocation = 6000;
 constexpr int kStatusShowClientsideChooseContact = 6000;
 constexpr int kStatusShowClientsidePlayGame = 10000;
 
+constexpr int kKeepLoadedHistoriesCount = 8; // never unload the 8 most recently shown histories
+constexpr int kLoadedItemsLimit = 10000; // unload histories while more items are loaded
+constexpr int kUnloadHistoryTimeoutMs = 1800000; // unload histories not shown for 30 minutes
+
 } // namespace
 
 void historyInit() {
@@ -558,6 +563,76 @@ void Histories::clear() {
 	Notify::unreadCounterUpdated();
 	App::historyClearItems();
 	typing.clear();
+	_shown.clear();
+}
+
+void Histories::historyShown(History *history) {
+	auto ms = getms(true);
+	for (auto i = _shown.begin(), e = _shown.end(); i != e; ++i) {
+		if (i->history == history) {
+			_shown.erase(i);
+			break;
+		}
+	}
+	_shown.push_back({ history, ms });
+
+	auto loadedItems = 0;
+	for_const (auto &shown, _shown) {
+		loadedItems += shown.history->loadedItemsCount();
+	}
+	for (auto i = _shown.begin(); _shown.end() - i > kKeepLoadedHistoriesCount;) {
+		if (ms < i->ms + kUnloadHistoryTimeoutMs && loadedItems <= kLoadedItemsLimit) {
+			break;
+		}
+		auto history = i->history;
+		if (!canUnload(history)) {
+			++i;
+			continue;
+		}
+		auto count = history->loadedItemsCount();
+		DEBUG_LOG(("History Info: unloading %1 items of peer %2").arg(count).arg(history->peer->id));
+		history->unloadBlocks();
+		loadedItems -= count;
+		i = _shown.erase(i);
+
+		auto pool = base::pool::stats();
+		DEBUG_LOG(("History Info: pool has %1 alive objects in %2 chunks, %3 allocations total").arg(pool.alive).arg(pool.chunks).arg(pool.allocations));
+	}
+}
+
+bool Histories::canUnload(History *history) const {
+	if (history->isEmpty()) {
+		return true;
+	}
+	if (!history->notifies.isEmpty()) {
+		return false;
+	}
+	if (App::main()) {
+		for (auto peer : { App::main()->historyPeer(), App::main()->overviewPeer(), App::main()->activePeer() }) {
+			if (peer && (peer == history->peer || peer->migrateFrom() == history->peer)) {
+				return false;
+			}
+		}
+	}
+	if (audioPlayer()) {
+		for (auto type : { AudioMsgId::Type::Voice, AudioMsgId::Type::Song }) {
+			AudioMsgId playing;
+			audioPlayer()->currentState(&playing, type);
+			if (auto item = App::histItemById(playing.contextId())) {
+				if (item->history() == history) {
+					return false;
+				}
+			}
+		}
+	}
+	for_const (auto block, history->blocks) {
+		for_const (auto item, block->items) {
+			if (item->id < 0) { // still sending
+				return false;
+			}
+		}
+	}
+	return true;
 }
 
 void Histories::regSendAction(History *history, UserData *user, const MTPSendMessageAction &action, TimeId when) {
@@ -622,6 +697,12 @@ void Histories::remove(const PeerId &peer) {
 	Map::iterator i = map.find(peer);
 	if (i != map.cend()) {
 		typing.remove(i.value());
+		for (auto j = _shown.begin(), e = _shown.end(); j != e; ++j) {
+			if (j->history == i.value()) {
+				_shown.erase(j);
+				break;
+			}
+		}
 		delete i.value();
 		map.erase(i);
 	}
@@ -1195,8 +1276,10 @@ void History::addItemToBlock(HistoryItem *item) {
 	}
 }
 
-void History::addOlderSlice(const QVector<MTPMessage> &slice) {
+void History::addOlderSlice(const QVector<MTPMessage> &slice, bool lastPart) {
 	if (slice.isEmpty()) {
+		_olderSlicePartAdded = false;
+		_olderSliceBlock = nullptr;
 		oldLoaded = true;
 		if (isChannel()) {
 			asChannelHistory()->checkJoinedMessage();
@@ -1205,21 +1288,36 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 		return;
 	}
 
-	startBuildingFrontBlock(slice.size());
+	HistoryBlock *block = nullptr;
+	auto addedCount = 0;
+	if (_olderSliceBlock) {
+		block = addToOlderSliceBlock(slice, addedCount);
+	} else {
+		startBuildingFrontBlock(slice.size());
 
-	for (auto i = slice.cend(), e = slice.cbegin(); i != e;) {
-		--i;
-		auto adding = createItem(*i, false, true);
-		if (!adding) continue;
+		for (auto i = slice.cend(), e = slice.cbegin(); i != e;) {
+			--i;
+			auto adding = createItem(*i, false, true);
+			if (!adding) continue;
 
-		addItemToBlock(adding);
-	}
+			addItemToBlock(adding);
+		}
 
-	auto block = finishBuildingFrontBlock();
-	if (!block) {
+		block = finishBuildingFrontBlock();
+		addedCount = block ? block->items.size() : 0;
+	}
+	if (lastPart) {
+		_olderSliceBlock = nullptr;
+	} else if (block) {
+		_olderSliceBlock = block;
+	}
+	if (block) {
+		_olderSlicePartAdded = !lastPart;
+	} else if (lastPart && !base::take(_olderSlicePartAdded)) {
 		// If no items were added it means we've loaded everything old.
 		oldLoaded = true;
-	} else if (loadedAtBottom()) { // add photos to overview and authors to lastAuthors / lastParticipants
+	}
+	if (block && loadedAtBottom()) { // add photos to overview and authors to lastAuthors / lastParticipants
 		bool channel = isChannel();
 		int32 mask = 0;
 		QList<UserData*> *lastAuthors = nullptr;
@@ -1231,7 +1329,7 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 			lastAuthors = &peer->asChannel()->mgInfo->lastParticipants;
 			markupSenders = &peer->asChannel()->mgInfo->markupSenders;
 		}
-		for (int32 i = block->items.size(); i > 0; --i) {
+		for (int32 i = addedCount; i > 0; --i) { // only the items added now are in the front of the block
 			auto item = block->items[i - 1];
 			mask |= item->addToOverview(AddToOverviewFront);
 			if (item->from()->id) {
@@ -1295,6 +1393,9 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 			if ((mask & (1 << t)) && App::wnd()) App::wnd()->mediaOverviewUpdated(peer, MediaOverviewType(t));
 		}
 	}
+	if (!lastPart) {
+		return;
+	}
 
 	if (isChannel()) {
 		asChannelHistory()->checkJoinedMessage();
@@ -1303,6 +1404,50 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 	checkLastMsg();
 }
 
+HistoryBlock *History::addToOlderSliceBlock(const QVector<MTPMessage> &slice, int &addedCount) {
+	QVector<HistoryItem*> added;
+	added.reserve(slice.size());
+	for (auto i = slice.cend(), e = slice.cbegin(); i != e;) {
+		--i;
+		auto adding = createItem(*i, false, true);
+		if (adding && !added.contains(adding)) {
+			added.push_back(adding);
+		}
+	}
+	addedCount = added.size();
+	if (added.isEmpty()) {
+		return nullptr;
+	}
+
+	// Creating the items could detach some items of the block or even remove it,
+	// some other block could be added to the front while the parts were added.
+	auto block = _olderSliceBlock;
+	if (!block || blocks.isEmpty() || blocks.front() != block) {
+		startBuildingFrontBlock(added.size());
+		for_const (auto item, added) {
+			addItemToBlock(item);
+		}
+		return finishBuildingFrontBlock();
+	}
+
+	auto &items = block->items;
+	auto wasCount = items.size();
+	items.insert(0, added.size(), nullptr);
+	for (int i = added.size(), l = items.size(); i < l; ++i) {
+		items.at(i)->setIndexInBlock(i);
+	}
+	for (int i = 0, l = added.size(); i < l; ++i) {
+		auto item = added.at(i);
+		item->attachToBlock(block, i);
+		items[i] = item;
+		item->previousItemChanged();
+	}
+	if (wasCount > 0) {
+		items.at(added.size())->previousItemChanged();
+	}
+	return block;
+}
+
 void History::addNewerSlice(const QVector<MTPMessage> &slice) {
 	bool wasEmpty = isEmpty(), wasLoadedAtBottom = loadedAtBottom();
 
@@ -1878,6 +2023,43 @@ bool History::isDisplayedEmpty() const {
 	return isEmpty() || ((blocks.size() == 1) && blocks.front()->items.size() == 1 && blocks.front()->items.front()->isEmpty());
 }
 
+int History::loadedItemsCount() const {
+	auto result = 0;
+	for_const (auto block, blocks) {
+		result += block->items.size();
+	}
+	return result;
+}
+
+void History::unloadBlocks() {
+	// Keep the message the last one replies to, so that its reply
+	// preview does not turn into a deleted message.
+	HistoryItem *lastReplyTo = nullptr;
+	if (lastMsg) {
+		if (auto reply = lastMsg->Get<HistoryMessageReply>()) {
+			lastReplyTo = reply->replyToMsg;
+		}
+	}
+
+	QVector<HistoryItem*> unloaded;
+	unloaded.reserve(loadedItemsCount());
+	for_const (auto block, blocks) {
+		for_const (auto item, block->items) {
+			if (item != lastMsg && item != lastReplyTo) {
+				unloaded.push_back(item);
+			}
+		}
+	}
+
+	clear(true);
+
+	auto &pending = Global::RefPendingRepaintItems();
+	for_const (auto item, unloaded) {
+		pending.remove(item);
+		delete item;
+	}
+}
+
 void History::clear(bool leaveItems) {
 	if (unreadBar) {
 		unreadBar = nullptr;
@@ -1945,6 +2127,8 @@ void History::clear(bool leaveItems) {
 }
 
 void History::clearBlocks(bool leaveItems) {
+	_olderSliceBlock = nullptr;
+
 	Blocks lst;
 	std::swap(lst, blocks);
 	for_const (HistoryBlock *block, lst) {
@@ -2103,6 +2287,9 @@ void History::removeBlock(HistoryBlock *block) {
 	if (_buildingFrontBlock && block == _buildingFrontBlock->block) {
 		_buildingFrontBlock->block = nullptr;
 	}
+	if (block == _olderSliceBlock) {
+		_olderSliceBlock = nullptr;
+	}
 
 	int index = block->indexInHistory();
 	blocks.removeAt(index);
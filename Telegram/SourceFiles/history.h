@@ -53,6 +53,12 @@ public:
 
 	void clear();
 	void remove(const PeerId &peer);
+
+	// Moves the history to the end of the recently shown list and unloads the
+	// blocks of the histories that were not shown for a long time, starting
+	// from the least recently shown, while too many items are loaded.
+	void historyShown(History *history);
+
 	~Histories() {
 		_unreadFull = _unreadMuted = 0;
 	}
@@ -83,8 +89,16 @@ public:
 	}
 
 private:
+	bool canUnload(History *history) const;
+
 	int _unreadFull, _unreadMuted;
 
+	struct ShownHistory {
+		History *history;
+		uint64 ms;
+	};
+	QList<ShownHistory> _shown; // the most recently shown history is the last
+
 };
 
 class HistoryBlock;
@@ -195,9 +209,14 @@ public:
 		return blocks.isEmpty();
 	}
 	bool isDisplayedEmpty() const;
+	int loadedItemsCount() const;
 
 	void clear(bool leaveItems = false);
 
+	// Destroys all loaded items except the last message, so that only the
+	// chats list row data remains, the history is loaded again when shown.
+	void unloadBlocks();
+
 	virtual ~History();
 
 	HistoryItem *addNewService(MsgId msgId, QDateTime date, const QString &text, MTPDmessage::Flags flags = 0, bool newMsg = true);
@@ -208,7 +227,14 @@ public:
 	HistoryItem *addNewPhoto(MsgId id, MTPDmessage::Flags flags, int32 viaBotId, MsgId replyTo, QDateTime date, int32 from, PhotoData *photo, const QString &caption, const MTPReplyMarkup &markup);
 	HistoryItem *addNewGame(MsgId id, MTPDmessage::Flags flags, int32 viaBotId, MsgId replyTo, QDateTime date, int32 from, GameData *game, const MTPReplyMarkup &markup);
 
-	void addOlderSlice(const QVector<MTPMessage> &slice);
+	// An older slice can be added in several parts, all of them except
+	// the last one are added with lastPart == false. The history is marked
+	// as loaded at top only if no items were added from all the parts.
+	void addOlderSlice(const QVector<MTPMessage> &slice, bool lastPart = true);
+	void cancelOlderSliceParts() { // the last part of the slice won't be added
+		_olderSlicePartAdded = false;
+		_olderSliceBlock = nullptr;
+	}
 	void addNewerSlice(const QVector<MTPMessage> &slice);
 	bool addToOverview(MediaOverviewType type, MsgId msgId, AddToOverviewMethod method);
 	void eraseFromOverview(MediaOverviewType type, MsgId msgId);
@@ -538,6 +564,12 @@ private:
 		HistoryBlock *block = nullptr;
 	};
 	std_::unique_ptr<BuildingBlock> _buildingFrontBlock;
+	bool _olderSlicePartAdded = false;
+
+	// The front block of a slice that is being added by parts,
+	// the next parts are put to it instead of new blocks.
+	HistoryBlock *_olderSliceBlock = nullptr;
+	HistoryBlock *addToOlderSliceBlock(const QVector<MTPMessage> &slice, int &addedCount);
 
 	// Creates if necessary a new block for adding item.
 	// Depending on isBuildingFrontBlock() gets front or back block.
@@ -571,7 +571,7 @@ void FieldAutocompleteInner::paintEvent(QPaintEvent *e) {
 				if (goodThumb) {
 					sticker->thumb->load();
 				} else {
-					sticker->checkSticker();
+					sticker->automaticLoad(nullptr);
 				}
 
 				float64 coef = qMin((st::stickerPanSize.width() - st::buttonRadius * 2) / float64(sticker->dimensions.width()), (st::stickerPanSize.height() - st::buttonRadius * 2) / float64(sticker->dimensions.height()));
@@ -582,8 +582,11 @@ void FieldAutocompleteInner::paintEvent(QPaintEvent *e) {
 				QPoint ppos = pos + QPoint((st::stickerPanSize.width() - w) / 2, (st::stickerPanSize.height() - h) / 2);
 				if (goodThumb) {
 					p.drawPixmapLeft(ppos, width(), sticker->thumb->pix(w, h));
-				} else if (!sticker->sticker()->img->isNull()) {
-					p.drawPixmapLeft(ppos, width(), sticker->sticker()->img->pix(w, h));
+				} else {
+					auto pixmap = sticker->stickerPix(w, h);
+					if (!pixmap.isNull()) {
+						p.drawPixmapLeft(ppos, width(), pixmap);
+					}
 				}
 			}
 		}
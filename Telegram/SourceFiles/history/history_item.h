@@ -40,6 +40,14 @@ public:
 
 	virtual ~HistoryElement() = default;
 
+	// Items and media are created by thousands when a history is loaded.
+	static void *operator new(std::size_t size) {
+		return base::pool::allocate(size);
+	}
+	static void operator delete(void *data, std::size_t size) {
+		base::pool::release(data, size);
+	}
+
 protected:
 	mutable int _maxw = 0;
 	mutable int _minh = 0;
@@ -2019,7 +2019,6 @@ void HistorySticker::draw(Painter &p, const QRect &r, TextSelection selection, u
 
 	if (_width < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
-	_data->checkSticker();
 	bool loaded = _data->loaded();
 	bool selected = (selection == FullSelection);
 
@@ -2038,16 +2037,18 @@ void HistorySticker::draw(Painter &p, const QRect &r, TextSelection selection, u
 	if (rtl()) usex = _width - usex - usew;
 
 	if (selected) {
+		_data->checkSticker();
 		if (sticker->img->isNull()) {
 			p.drawPixmap(QPoint(usex + (usew - _pixw) / 2, (_minh - _pixh) / 2), _data->thumb->pixBlurredColored(st::msgStickerOverlay, _pixw, _pixh));
 		} else {
 			p.drawPixmap(QPoint(usex + (usew - _pixw) / 2, (_minh - _pixh) / 2), sticker->img->pixColored(st::msgStickerOverlay, _pixw, _pixh));
 		}
 	} else {
-		if (sticker->img->isNull()) {
+		auto pixmap = _data->stickerPix(_pixw, _pixh);
+		if (pixmap.isNull()) {
 			p.drawPixmap(QPoint(usex + (usew - _pixw) / 2, (_minh - _pixh) / 2), _data->thumb->pixBlurred(_pixw, _pixh));
 		} else {
-			p.drawPixmap(QPoint(usex + (usew - _pixw) / 2, (_minh - _pixh) / 2), sticker->img->pix(_pixw, _pixh));
+			p.drawPixmap(QPoint(usex + (usew - _pixw) / 2, (_minh - _pixh) / 2), pixmap);
 		}
 	}
 
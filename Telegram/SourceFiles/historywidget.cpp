@@ -55,6 +55,9 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 
 namespace {
 
+constexpr int kPreloadedSlicePartSize = 10;
+constexpr int kPreloadedSliceBudgetMs = 8; // add more parts while we fit in one frame
+
 QString mimeTagFromTag(const QString &tagId) {
 	if (tagId.startsWith(qstr("mention://"))) {
 		return tagId + ':' + QString::number(MTP::authedId());
@@ -137,12 +140,12 @@ HistoryInner::HistoryInner(HistoryWidget *historyWidget, ScrollArea *scroll, His
 	});
 }
 
-void HistoryInner::messagesReceived(PeerData *peer, const QVector<MTPMessage> &messages) {
+void HistoryInner::messagesReceived(PeerData *peer, const QVector<MTPMessage> &messages, bool lastPart) {
 	if (_history && _history->peer == peer) {
-		_history->addOlderSlice(messages);
+		_history->addOlderSlice(messages, lastPart);
 	} else if (_migrated && _migrated->peer == peer) {
 		bool newLoaded = (_migrated && _migrated->isEmpty() && !_history->isEmpty());
-		_migrated->addOlderSlice(messages);
+		_migrated->addOlderSlice(messages, lastPart);
 		if (newLoaded) {
 			_migrated->addNewerSlice(QVector<MTPMessage>());
 		}
@@ -1654,6 +1657,50 @@ void HistoryInner::setFirstLoading(bool loading) {
 	update();
 }
 
+void HistoryInner::prefetchMedia(int top, int bottom) {
+	_mediaPrefetcher.visibleAreaUpdated(top, bottom);
+
+	int from = _mediaPrefetcher.prefetchTop(), till = _mediaPrefetcher.prefetchBottom();
+	prefetchMediaInHistory(_history, historyTop(), from, till);
+	if (_migrated) {
+		prefetchMediaInHistory(_migrated, migratedTop(), from, till);
+	}
+	_mediaPrefetcher.finish();
+}
+
+void HistoryInner::prefetchMediaInHistory(History *history, int historytop, int from, int till) {
+	if (historytop < 0 || history->isEmpty()) {
+		return;
+	}
+	if (till <= historytop || historytop + history->height <= from) {
+		return;
+	}
+
+	// same as in enumerateItemsInHistory(), but for the prefetch range and without any changes of the items
+	int blockIndex = binarySearchBlocksOrItems(history->blocks, till - historytop);
+	HistoryBlock *block = history->blocks.at(blockIndex);
+	int blocktop = historytop + block->y;
+	int itemIndex = binarySearchBlocksOrItems(block->items, till - blocktop);
+	while (true) {
+		for (; itemIndex >= 0; --itemIndex) {
+			HistoryItem *item = block->items.at(itemIndex);
+			int itemtop = blocktop + item->y, itembottom = itemtop + item->height();
+			if (itembottom <= from) {
+				return;
+			}
+			if (!_mediaPrefetcher.visible(itemtop, itembottom)) {
+				_mediaPrefetcher.add(item);
+			}
+		}
+		if (blocktop <= from || --blockIndex < 0) {
+			return;
+		}
+		block = history->blocks.at(blockIndex);
+		blocktop = historytop + block->y;
+		itemIndex = block->items.size() - 1;
+	}
+}
+
 void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	_visibleAreaTop = top;
 	_visibleAreaBottom = bottom;
@@ -3038,7 +3085,7 @@ HistoryWidget::HistoryWidget(QWidget *parent) : TWidget(parent)
 , _emojiPan(this)
 , _attachDragDocument(this)
 , _attachDragPhoto(this)
-, _fileLoader(this, FileLoaderQueueStopTimeout)
+, _fileLoader(this, FileLoaderQueueStopTimeout, qMin(QThread::idealThreadCount(), int(FileLoaderQueueMaxThreads)), FileLoaderQueueMemoryLimit)
 , _a_show(animation(this, &HistoryWidget::step_show))
 , _topShadow(this, st::shadowColor) {
 	_scroll.setFocusPolicy(Qt::NoFocus);
@@ -3541,7 +3588,7 @@ void HistoryWidget::updateStickers() {
 	auto now = getms(true);
 	if (!Global::LastStickersUpdate() || now >= Global::LastStickersUpdate() + StickersUpdateTimeout) {
 		if (!_stickersUpdateRequest) {
-			_stickersUpdateRequest = MTP::send(MTPmessages_GetAllStickers(MTP_int(Local::countStickersHash(true))), rpcDone(&HistoryWidget::stickersGot), rpcFail(&HistoryWidget::stickersFailed));
+			_stickersUpdateRequest = MTP::send(MTPmessages_GetAllStickers(MTP_int(Local::countStickersHash(true))), rpcParseAnywhere(rpcDone(&HistoryWidget::stickersGot)), rpcFail(&HistoryWidget::stickersFailed), 0, 0, 0, MTP::RequestPriority::Background);
 		}
 	}
 	if (!Global::LastRecentStickersUpdate() || now >= Global::LastRecentStickersUpdate() + StickersUpdateTimeout) {
@@ -4278,6 +4325,10 @@ void HistoryWidget::showHistory(const PeerId &peerId, MsgId showAtMsgId, bool re
 
 		_history = App::history(_peer->id);
 		_migrated = _peer->migrateFrom() ? App::history(_peer->migrateFrom()->id) : 0;
+		if (_migrated) {
+			App::histories().historyShown(_migrated);
+		}
+		App::histories().historyShown(_history);
 
 		if (_channel) {
 			updateNotifySettings();
@@ -4363,6 +4414,7 @@ void HistoryWidget::clearAllLoadRequests() {
 	if (_preloadRequest) MTP::cancel(_preloadRequest);
 	if (_preloadDownRequest) MTP::cancel(_preloadDownRequest);
 	_preloadRequest = _preloadDownRequest = _firstLoadRequest = 0;
+	clearPreloadedSlice();
 }
 
 void HistoryWidget::contactsReceived() {
@@ -4828,12 +4880,14 @@ bool HistoryWidget::messagesFailed(const RPCError &error, mtpRequestId requestId
 void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages &messages, mtpRequestId requestId) {
 	if (!_history) {
 		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = 0;
+		clearPreloadedSlice();
 		return;
 	}
 
 	bool toMigrated = (peer == _peer->migrateFrom());
 	if (peer != _peer && !toMigrated) {
 		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = 0;
+		clearPreloadedSlice();
 		return;
 	}
 
@@ -4869,13 +4923,10 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 	}
 
 	if (_preloadRequest == requestId) {
-		addMessagesToFront(peer, *histList);
-		_preloadRequest = 0;
-		preloadHistoryIfNeeded();
-		if (_reportSpamStatus == dbiprsUnknown) {
-			updateReportSpamStatus();
-			if (_reportSpamStatus != dbiprsUnknown) updateControlsVisibility();
-		}
+		_preloadedSlice = *histList;
+		_preloadedSlicePeer = peer;
+		_preloadedSliceAdded = 0;
+		onPreloadedSliceAdd();
 	} else if (_preloadDownRequest == requestId) {
 		addMessagesToBack(peer, *histList);
 		_preloadDownRequest = 0;
@@ -4914,6 +4965,7 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 			if (_preloadDownRequest) MTP::cancel(_preloadDownRequest);
 			if (_firstLoadRequest) MTP::cancel(_firstLoadRequest);
 			_preloadRequest = _preloadDownRequest = 0;
+			clearPreloadedSlice();
 			_firstLoadRequest = -1; // hack - don't updateListSize yet
 			addMessagesToFront(peer, *histList);
 			_firstLoadRequest = 0;
@@ -5113,6 +5165,7 @@ void HistoryWidget::visibleAreaUpdated() {
 		int scrollTop = _scroll.scrollTop();
 		int scrollBottom = scrollTop + _scroll.height();
 		_list->visibleAreaUpdated(scrollTop, scrollBottom);
+		_list->prefetchMedia(scrollTop, scrollBottom);
 		if (_history->loadedAtBottom() && (_history->unreadCount() > 0 || (_migrated && _migrated->unreadCount() > 0))) {
 			auto showFrom = (_migrated && _migrated->showFrom) ? _migrated->showFrom : (_history ? _history->showFrom : nullptr);
 			if (showFrom && !showFrom->detached() && scrollBottom > _list->itemTop(showFrom) && App::wnd()->doWeReadServerHistory()) {
@@ -7286,8 +7339,49 @@ int HistoryWidget::unreadBarTop() const {
 	return -1;
 }
 
-void HistoryWidget::addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages) {
-	_list->messagesReceived(peer, messages);
+void HistoryWidget::onPreloadedSliceAdd() {
+	auto peer = _preloadedSlicePeer;
+	if (!peer || !_preloadRequest) {
+		return;
+	}
+
+	// Each part creates items and lays them out, so we add
+	// only as many of them as fit in the time budget.
+	auto ms = getms(true);
+	auto count = _preloadedSlice.size();
+	do {
+		auto part = _preloadedSlice.mid(_preloadedSliceAdded, kPreloadedSlicePartSize);
+		_preloadedSliceAdded += part.size();
+		addMessagesToFront(peer, part, (_preloadedSliceAdded == count));
+	} while (_preloadedSliceAdded < count && getms(true) - ms < kPreloadedSliceBudgetMs);
+
+	if (_preloadedSliceAdded < count) {
+		QTimer::singleShot(0, this, SLOT(onPreloadedSliceAdd()));
+		return;
+	}
+
+	clearPreloadedSlice();
+	_preloadRequest = 0;
+	preloadHistoryIfNeeded();
+	if (_reportSpamStatus == dbiprsUnknown) {
+		updateReportSpamStatus();
+		if (_reportSpamStatus != dbiprsUnknown) updateControlsVisibility();
+	}
+}
+
+void HistoryWidget::clearPreloadedSlice() {
+	if (_preloadedSlicePeer && _preloadedSliceAdded > 0 && _preloadedSliceAdded < _preloadedSlice.size()) {
+		if (auto history = App::historyLoaded(_preloadedSlicePeer)) {
+			history->cancelOlderSliceParts();
+		}
+	}
+	_preloadedSlice.clear();
+	_preloadedSlicePeer = nullptr;
+	_preloadedSliceAdded = 0;
+}
+
+void HistoryWidget::addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages, bool lastPart) {
+	_list->messagesReceived(peer, messages, lastPart);
 	if (!_firstLoadRequest) {
 		updateListSize();
 		if (_animActiveTimer.isActive() && _activeAnimMsgId > 0 && _migrated && !_migrated->isEmpty() && _migrated->loadedAtBottom() && _migrated->blocks.back()->items.back()->isGroupMigrate() && _list->historyTop() != _list->historyDrawTop() && _history) {
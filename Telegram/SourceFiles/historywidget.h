@@ -27,6 +27,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "history/field_autocomplete.h"
 #include "window/section_widget.h"
 #include "core/single_timer.h"
+#include "data/data_media_prefetch.h"
 
 namespace InlineBots {
 namespace Layout {
@@ -52,7 +53,7 @@ class HistoryInner : public TWidget, public AbstractTooltipShower, private base:
 public:
 	HistoryInner(HistoryWidget *historyWidget, ScrollArea *scroll, History *history);
 
-	void messagesReceived(PeerData *peer, const QVector<MTPMessage> &messages);
+	void messagesReceived(PeerData *peer, const QVector<MTPMessage> &messages, bool lastPart = true);
 	void messagesReceivedDown(PeerData *peer, const QVector<MTPMessage> &messages);
 
 	void showContextMenu(QContextMenuEvent *e, bool showFromTouch = false);
@@ -88,6 +89,9 @@ public:
 	// updates history->scrollTopItem/scrollTopOffset
 	void visibleAreaUpdated(int top, int bottom);
 
+	// starts low priority loading of the media in the scroll direction
+	void prefetchMedia(int top, int bottom);
+
 	int historyHeight() const;
 	int historyScrollTop() const;
 	int migratedTop() const;
@@ -262,6 +266,9 @@ private:
 	int _visibleAreaTop = 0;
 	int _visibleAreaBottom = 0;
 
+	Data::MediaPrefetcher _mediaPrefetcher = { Data::MediaPrefetcher::PhotoSize::Full };
+	void prefetchMediaInHistory(History *history, int historytop, int from, int till);
+
 	bool _scrollDateShown = false;
 	FloatAnimation _scrollDateOpacity;
 	SingleDelayedCall _scrollDateCheck = { this, "onScrollDateCheck" };
@@ -846,6 +853,8 @@ private slots:
 
 	void updateField();
 
+	void onPreloadedSliceAdd();
+
 private:
 	void itemRemoved(HistoryItem *item);
 
@@ -944,7 +953,8 @@ private:
 	QList<MsgId> _replyReturns;
 
 	bool messagesFailed(const RPCError &error, mtpRequestId requestId);
-	void addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages);
+	void addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages, bool lastPart = true);
+	void clearPreloadedSlice();
 	void addMessagesToBack(PeerData *peer, const QVector<MTPMessage> &messages);
 
 	struct BotCallbackInfo {
@@ -1048,6 +1058,13 @@ private:
 	mtpRequestId _preloadRequest = 0;
 	mtpRequestId _preloadDownRequest = 0;
 
+	// Older messages received by _preloadRequest are added in parts
+	// in several event loop iterations, the request is considered
+	// to be finished only when all of them are added.
+	QVector<MTPMessage> _preloadedSlice;
+	PeerData *_preloadedSlicePeer = nullptr;
+	int _preloadedSliceAdded = 0;
+
 	MsgId _delayedShowAtMsgId = -1; // wtf?
 	mtpRequestId _delayedShowAtRequest = 0;
 
@@ -30,7 +30,10 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "lang.h"
 #include "boxes/confirmbox.h"
 
-TaskQueue::TaskQueue(QObject *parent, int32 stopTimeoutMs) : QObject(parent), _thread(0), _worker(0), _stopTimer(0) {
+TaskQueue::TaskQueue(QObject *parent, int32 stopTimeoutMs, int32 threadsCount, int64 memoryLimit) : QObject(parent)
+, _threadsCount(threadsCount > 0 ? threadsCount : qMax(QThread::idealThreadCount(), 1))
+, _memoryLimit(memoryLimit)
+, _stopTimer(0) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -60,16 +63,25 @@ void TaskQueue::addTasks(const TasksList &tasks) {
 }
 
 void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+	int32 tasksCount = 0;
+	{
+		QMutexLocker lock(&_tasksToProcessMutex);
+		tasksCount = _tasksToProcess.size();
+	}
+	int32 threadsNeeded = qMin(_threadsCount, qMax(tasksCount, 1));
+	while (_threads.size() < threadsNeeded) {
+		auto thread = new QThread();
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+		auto worker = new TaskQueueWorker(this);
+		worker->moveToThread(thread);
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+		connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+		connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+		thread->start();
+
+		_threads.push_back(thread);
+		_workers.push_back(worker);
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
@@ -81,6 +93,7 @@ void TaskQueue::cancelTask(TaskId id) {
 		for (int32 i = 0, l = _tasksToProcess.size(); i != l; ++i) {
 			if (_tasksToProcess.at(i)->id() == id) {
 				_tasksToProcess.removeAt(i);
+				_tasksProcessed.remove(id);
 				return;
 			}
 		}
@@ -94,6 +107,43 @@ void TaskQueue::cancelTask(TaskId id) {
 	}
 }
 
+TaskPtr TaskQueue::startNextTask() {
+	QMutexLocker lock(&_tasksToProcessMutex);
+	for_const (auto &task, _tasksToProcess) {
+		auto id = task->id();
+		if (_tasksProcessing.contains(id) || _tasksProcessed.contains(id)) {
+			continue;
+		}
+
+		// Always allow at least one task, even if it alone exceeds the limit.
+		auto memory = task->memoryEstimate();
+		if (_memoryLimit > 0 && !_tasksProcessing.isEmpty() && _memoryProcessing + memory > _memoryLimit) {
+			break;
+		}
+		_tasksProcessing.insert(id);
+		_memoryProcessing += memory;
+		return task;
+	}
+	return TaskPtr();
+}
+
+bool TaskQueue::finishProcessingTask(const TaskPtr &task) {
+	QMutexLocker lockToProcess(&_tasksToProcessMutex);
+	_tasksProcessing.remove(task->id());
+	_memoryProcessing -= task->memoryEstimate();
+	if (_tasksToProcess.contains(task)) { // could be cancelled while processing
+		_tasksProcessed.insert(task->id());
+	}
+
+	QMutexLocker lockToFinish(&_tasksToFinishMutex);
+	while (!_tasksToProcess.isEmpty() && _tasksProcessed.contains(_tasksToProcess.front()->id())) {
+		_tasksProcessed.remove(_tasksToProcess.front()->id());
+		_tasksToFinish.push_back(_tasksToProcess.front());
+		_tasksToProcess.pop_front();
+	}
+	return (_tasksToProcess.size() > _tasksProcessing.size() + _tasksProcessed.size());
+}
+
 void TaskQueue::onTaskProcessed() {
 	do {
 		TaskPtr task;
@@ -106,27 +156,45 @@ void TaskQueue::onTaskProcessed() {
 		task->finish();
 	} while (true);
 
-	if (_stopTimer) {
+	bool wakeWorkers = false;
+	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		if (_tasksToProcess.isEmpty()) {
-			_stopTimer->start();
+			if (_stopTimer) _stopTimer->start();
+		} else if (_threads.size() > 1) {
+			// Some workers could be idle waiting for the memory limit.
+			wakeWorkers = (_tasksToProcess.size() > _tasksProcessing.size() + _tasksProcessed.size());
 		}
 	}
+	if (wakeWorkers) {
+		emit taskAdded();
+	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	if (!_threads.isEmpty()) {
+		for_const (auto thread, _threads) {
+			thread->requestInterruption();
+			thread->quit();
+		}
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete _worker;
-		delete _thread;
-		_worker = 0;
-		_thread = 0;
+		for_const (auto thread, _threads) {
+			thread->wait();
+		}
+		for_const (auto worker, _workers) {
+			delete worker;
+		}
+		for_const (auto thread, _threads) {
+			delete thread;
+		}
+		_workers.clear();
+		_threads.clear();
 	}
 	_tasksToProcess.clear();
 	_tasksToFinish.clear();
+	_tasksProcessing.clear();
+	_tasksProcessed.clear();
+	_memoryProcessing = 0;
 }
 
 TaskQueue::~TaskQueue() {
@@ -140,31 +208,13 @@ void TaskQueueWorker::onTaskAdded() {
 
 	bool someTasksLeft = false;
 	do {
-		TaskPtr task;
-		{
-			QMutexLocker lock(&_queue->_tasksToProcessMutex);
-			if (!_queue->_tasksToProcess.isEmpty()) {
-				task = _queue->_tasksToProcess.front();
-			}
-		}
-
-		if (task) {
+		someTasksLeft = false;
+		if (auto task = _queue->startNextTask()) {
 			task->process();
-			bool emitTaskProcessed = false;
-			{
-				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (!_queue->_tasksToProcess.isEmpty() && _queue->_tasksToProcess.front() == task) {
-					_queue->_tasksToProcess.pop_front();
-					someTasksLeft = !_queue->_tasksToProcess.isEmpty();
-
-					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.isEmpty();
-					_queue->_tasksToFinish.push_back(task);
-				}
-			}
-			if (emitTaskProcessed) {
-				emit taskProcessed();
-			}
+			someTasksLeft = _queue->finishProcessingTask(task);
+
+			// Always notify the queue, so it can wake the workers idle because of the memory limit.
+			emit taskProcessed();
 		}
 		QCoreApplication::processEvents();
 	} while (someTasksLeft && !thread()->isInterruptionRequested());
@@ -177,12 +227,14 @@ FileLoadTask::FileLoadTask(const QString &filepath, PrepareMediaType type, const
 , _filepath(filepath)
 , _type(type)
 , _confirm(confirm) {
+	countMemoryEstimate();
 }
 
 FileLoadTask::FileLoadTask(const QByteArray &content, PrepareMediaType type, const FileLoadTo &to) : _id(rand_value<uint64>())
 , _to(to)
 , _content(content)
 , _type(type) {
+	countMemoryEstimate();
 }
 
 FileLoadTask::FileLoadTask(const QImage &image, PrepareMediaType type, const FileLoadTo &to, FileLoadForceConfirmType confirm, const QString &originalText) : _id(rand_value<uint64>())
@@ -191,6 +243,7 @@ FileLoadTask::FileLoadTask(const QImage &image, PrepareMediaType type, const Fil
 , _type(type)
 , _confirm(confirm)
 , _originalText(originalText) {
+	countMemoryEstimate();
 }
 
 FileLoadTask::FileLoadTask(const QByteArray &voice, int32 duration, const VoiceWaveform &waveform, const FileLoadTo &to) : _id(rand_value<uint64>())
@@ -199,6 +252,24 @@ FileLoadTask::FileLoadTask(const QByteArray &voice, int32 duration, const VoiceW
 , _duration(duration)
 , _waveform(waveform)
 , _type(PrepareAudio) {
+	countMemoryEstimate();
+}
+
+void FileLoadTask::countMemoryEstimate() {
+	// Encoded images take several times more memory after decoding and resampling.
+	const int64 DecodedSizeMultiplier = 8;
+
+	if (_type == PrepareAudio) {
+		_memoryEstimate = _content.size();
+	} else if (!_filepath.isEmpty()) {
+		auto size = QFileInfo(_filepath).size();
+		_memoryEstimate = (size <= MaxUploadPhotoSize) ? size * DecodedSizeMultiplier : 0;
+	} else if (!_content.isEmpty()) {
+		auto size = int64(_content.size());
+		_memoryEstimate = (size <= MaxUploadPhotoSize) ? size * DecodedSizeMultiplier : size;
+	} else if (!_image.isNull()) {
+		_memoryEstimate = int64(_image.byteCount()) * 2;
+	}
 }
 
 void FileLoadTask::process() {
@@ -357,26 +428,33 @@ void FileLoadTask::process() {
 		attributes.push_back(MTP_documentAttributeImageSize(MTP_int(w), MTP_int(h)));
 
 		if (w < 20 * h && h < 20 * w) {
+			// Each smaller size is resampled from the previous one instead of the original image.
+			QImage thumbSource = fullimage;
 			if (animated) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != PrepareDocument) {
-				QPixmap thumb = (w > 100 || h > 100) ? App::pixmapFromImageInPlace(fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('s', thumb);
-				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
-
-				QPixmap medium = (w > 320 || h > 320) ? App::pixmapFromImageInPlace(fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('m', medium);
-				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
-
-				QPixmap full = (w > 1280 || h > 1280) ? App::pixmapFromImageInPlace(fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage);
-				photoThumbs.insert('y', full);
-				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
+				QImage full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				QImage medium = (w > 320 || h > 320) ? full.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				QImage small = (w > 100 || h > 100) ? medium.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				thumbSource = medium;
 
 				{
 					QBuffer buffer(&filedata);
 					full.save(&buffer, "JPG", 77);
 				}
 
+				QPixmap thumb = App::pixmapFromImageInPlace(std_::move(small));
+				photoThumbs.insert('s', thumb);
+				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
+
+				QPixmap mediumPixmap = App::pixmapFromImageInPlace(std_::move(medium));
+				photoThumbs.insert('m', mediumPixmap);
+				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(mediumPixmap.width()), MTP_int(mediumPixmap.height()), MTP_int(0)));
+
+				QPixmap fullPixmap = App::pixmapFromImageInPlace(std_::move(full));
+				photoThumbs.insert('y', fullPixmap);
+				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationUnavailable(MTP_long(0), MTP_int(0), MTP_long(0)), MTP_int(fullPixmap.width()), MTP_int(fullPixmap.height()), MTP_int(0)));
+
 				MTPDphoto::Flags photoFlags = 0;
 				photo = MTP_photo(MTP_flags(photoFlags), MTP_long(_id), MTP_long(0), MTP_int(unixtime()), MTP_vector<MTPPhotoSize>(photoSizes));
 			}
@@ -390,7 +468,7 @@ void FileLoadTask::process() {
 				thumbname = qsl("thumb.webp");
 			}
 
-			QPixmap full = (w > 90 || h > 90) ? App::pixmapFromImageInPlace(fullimage.scaled(90, 90, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage, Qt::ColorOnly);
+			QPixmap full = (w > 90 || h > 90) ? App::pixmapFromImageInPlace(thumbSource.scaled(90, 90, Qt::KeepAspectRatio, Qt::SmoothTransformation)) : QPixmap::fromImage(fullimage, Qt::ColorOnly);
 
 			{
 				QBuffer buffer(&thumbdata);
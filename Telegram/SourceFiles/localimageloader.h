@@ -89,6 +89,9 @@ public:
 
 	virtual void process() = 0; // is executed in a separate thread
 	virtual void finish() = 0; // is executed in the same as TaskQueue thread
+	virtual int64 memoryEstimate() const { // bytes held while process() is running
+		return 0;
+	}
 	virtual ~Task() {
 	}
 
@@ -106,7 +109,7 @@ class TaskQueue : public QObject {
 
 public:
 
-	TaskQueue(QObject *parent, int32 stopTimeoutMs = 0); // <= 0 - never stop worker
+	TaskQueue(QObject *parent, int32 stopTimeoutMs = 0, int32 threadsCount = 1, int64 memoryLimit = 0); // stopTimeoutMs <= 0 - never stop workers, threadsCount <= 0 - ideal thread count, memoryLimit <= 0 - no limit
 
 	TaskId addTask(TaskPtr task);
 	void addTasks(const TasksList &tasks);
@@ -133,10 +136,21 @@ private:
 
 	void wakeThread();
 
+	// Called from the worker threads.
+	TaskPtr startNextTask();
+	bool finishProcessingTask(const TaskPtr &task); // returns true if there are tasks left to start
+
+	// Tasks stay in _tasksToProcess until all the tasks before them are processed,
+	// so that finish() is called in the same order the tasks were added.
 	TasksList _tasksToProcess, _tasksToFinish;
+	OrderedSet<TaskId> _tasksProcessing, _tasksProcessed;
+	int64 _memoryProcessing = 0;
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread;
-	TaskQueueWorker *_worker;
+
+	int32 _threadsCount;
+	int64 _memoryLimit;
+	QList<QThread*> _threads;
+	QList<TaskQueueWorker*> _workers;
 	QTimer *_stopTimer;
 
 };
@@ -255,9 +269,14 @@ public:
 
 	void process();
 	void finish();
+	int64 memoryEstimate() const override {
+		return _memoryEstimate;
+	}
 
 protected:
 
+	void countMemoryEstimate();
+
 	uint64 _id;
 	FileLoadTo _to;
 	QString _filepath;
@@ -268,6 +287,7 @@ protected:
 	PrepareMediaType _type;
 	FileLoadForceConfirmType _confirm = FileLoadNoForceConfirm;
 	QString _originalText;
+	int64 _memoryEstimate = 0;
 
 	FileLoadResultPtr _result;
 
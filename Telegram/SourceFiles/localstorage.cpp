@@ -552,6 +552,7 @@ enum {
 	dbiNativeNotifications = 0x44,
 	dbiNotificationsCount  = 0x45,
 	dbiNotificationsCorner = 0x46,
+	dbiDhPrimes = 0x47,
 
 	dbiEncryptedWithSalt = 333,
 	dbiEncrypted = 444,
@@ -578,8 +579,13 @@ typedef QMap<MediaKey, MediaKey> FileLocationAliases;
 FileLocationAliases _fileLocationAliases;
 typedef QMap<QString, FileDesc> WebFilesMap;
 WebFilesMap _webFilesMap;
+typedef QMap<MediaKey, PartialDownload> PartialDownloads;
+PartialDownloads _partialDownloads;
+typedef QMap<QString, PartialUpload> PartialUploads;
+PartialUploads _partialUploads;
 uint64 _storageWebFilesSize = 0;
 FileKey _locationsKey = 0, _reportSpamStatusesKey = 0, _trustedBotsKey = 0;
+bool _locationsWereRead = false;
 
 using TrustedBots = OrderedSet<uint64>;
 TrustedBots _trustedBots;
@@ -613,6 +619,7 @@ enum WriteMapWhen {
 };
 
 void _writeMap(WriteMapWhen when = WriteMapSoon);
+void _ensureLocationsRead();
 
 void _writeLocations(WriteMapWhen when = WriteMapSoon) {
 	if (when != WriteMapNow) {
@@ -621,8 +628,10 @@ void _writeLocations(WriteMapWhen when = WriteMapSoon) {
 	}
 	if (!_working()) return;
 
+	_ensureLocationsRead();
+
 	_manager->writingLocations();
-	if (_fileLocations.isEmpty() && _webFilesMap.isEmpty()) {
+	if (_fileLocations.isEmpty() && _webFilesMap.isEmpty() && _partialDownloads.isEmpty() && _partialUploads.isEmpty()) {
 		if (_locationsKey) {
 			clearKey(_locationsKey);
 			_locationsKey = 0;
@@ -666,6 +675,18 @@ void _writeLocations(WriteMapWhen when = WriteMapSoon) {
 			size += Serialize::stringSize(i.key()) + sizeof(quint64) + sizeof(qint32);
 		}
 
+		size += sizeof(quint32); // partial downloads count
+		for (PartialDownloads::const_iterator i = _partialDownloads.cbegin(), e = _partialDownloads.cend(); i != e; ++i) {
+			// location + name + offset
+			size += sizeof(quint64) * 2 + Serialize::stringSize(i.value().fname) + sizeof(qint32);
+		}
+
+		size += sizeof(quint32); // partial uploads count
+		for (PartialUploads::const_iterator i = _partialUploads.cbegin(), e = _partialUploads.cend(); i != e; ++i) {
+			// path + file id + size + modified + part size + parts uploaded + updated
+			size += Serialize::stringSize(i.key()) + sizeof(quint64) + sizeof(qint32) + Serialize::dateTimeSize() + sizeof(qint32) * 2 + Serialize::dateTimeSize();
+		}
+
 		EncryptedDescriptor data(size);
 		for (FileLocations::const_iterator i = _fileLocations.cbegin(); i != _fileLocations.cend(); ++i) {
 			data.stream << quint64(i.key().first) << quint64(i.key().second) << quint32(i.value().type) << i.value().name();
@@ -691,6 +712,17 @@ void _writeLocations(WriteMapWhen when = WriteMapSoon) {
 			data.stream << i.key() << quint64(i.value().first) << qint32(i.value().second);
 		}
 
+		data.stream << quint32(_partialDownloads.size());
+		for (PartialDownloads::const_iterator i = _partialDownloads.cbegin(), e = _partialDownloads.cend(); i != e; ++i) {
+			data.stream << quint64(i.key().first) << quint64(i.key().second) << i.value().fname << qint32(i.value().offset);
+		}
+
+		data.stream << quint32(_partialUploads.size());
+		for (PartialUploads::const_iterator i = _partialUploads.cbegin(), e = _partialUploads.cend(); i != e; ++i) {
+			data.stream << i.key() << quint64(i.value().fileId) << qint32(i.value().size) << i.value().modified;
+			data.stream << qint32(i.value().partSize) << qint32(i.value().partsUploaded) << i.value().updated;
+		}
+
 		FileWriteDescriptor file(_locationsKey);
 		file.writeEncrypted(data);
 	}
@@ -754,6 +786,38 @@ void _readLocations() {
 				_storageWebFilesSize += size;
 			}
 		}
+
+		if (!locations.stream.atEnd()) {
+			quint32 partialDownloadsCount;
+			locations.stream >> partialDownloadsCount;
+			for (quint32 i = 0; i < partialDownloadsCount; ++i) {
+				quint64 first, second;
+				PartialDownload partial;
+				locations.stream >> first >> second >> partial.fname >> partial.offset;
+				_partialDownloads.insert(MediaKey(first, second), partial);
+			}
+
+			quint32 partialUploadsCount;
+			locations.stream >> partialUploadsCount;
+			for (quint32 i = 0; i < partialUploadsCount; ++i) {
+				QString path;
+				PartialUpload partial;
+				locations.stream >> path >> partial.fileId >> partial.size >> partial.modified;
+				locations.stream >> partial.partSize >> partial.partsUploaded >> partial.updated;
+				_partialUploads.insert(path, partial);
+			}
+		}
+	}
+}
+
+// File locations are needed only when some media is opened or loaded,
+// so they are read on the first access and not in readMap().
+void _ensureLocationsRead() {
+	if (_locationsWereRead) return;
+
+	_locationsWereRead = true;
+	if (_locationsKey) {
+		_readLocations();
 	}
 }
 
@@ -894,6 +958,23 @@ bool _readSetting(quint32 blockId, QDataStream &stream, int version) {
 		MTP::setKey(dcId, keyPtr);
 	} break;
 
+	case dbiDhPrimes: {
+		quint32 count;
+		stream >> count;
+		if (!_checkStreamStatus(stream)) return false;
+
+		for (quint32 i = 0; i < count; ++i) {
+			qint32 g;
+			QByteArray prime;
+			stream >> g >> prime;
+			if (!_checkStreamStatus(stream)) return false;
+
+			if (prime.size() == 256) {
+				MTP::setDhPrime(prime, g);
+			}
+		}
+	} break;
+
 	case dbiAutoStart: {
 		qint32 v;
 		stream >> v;
@@ -1698,9 +1779,16 @@ void _writeMtpData() {
 	}
 
 	MTP::AuthKeysMap keys = MTP::getKeys();
+	MTP::DhPrimes dhPrimes = MTP::getDhPrimes();
 
 	quint32 size = sizeof(quint32) + sizeof(qint32) + sizeof(quint32);
 	size += keys.size() * (sizeof(quint32) + sizeof(quint32) + 256);
+	if (!dhPrimes.isEmpty()) {
+		size += sizeof(quint32) + sizeof(quint32);
+		for_const (const MTP::DhPrime &dhPrime, dhPrimes) {
+			size += sizeof(qint32) + Serialize::bytearraySize(dhPrime.prime);
+		}
+	}
 
 	EncryptedDescriptor data(size);
 	data.stream << quint32(dbiUser) << qint32(MTP::authedId()) << quint32(MTP::maindc());
@@ -1708,6 +1796,12 @@ void _writeMtpData() {
 		data.stream << quint32(dbiKey) << quint32(key->getDC());
 		key->write(data.stream);
 	}
+	if (!dhPrimes.isEmpty()) {
+		data.stream << quint32(dbiDhPrimes) << quint32(dhPrimes.size());
+		for_const (const MTP::DhPrime &dhPrime, dhPrimes) {
+			data.stream << qint32(dhPrime.g) << dhPrime.prime;
+		}
+	}
 
 	mtp.writeEncrypted(data, _localKey);
 }
@@ -1931,9 +2025,7 @@ ReadMapState _readMap(const QByteArray &pass) {
 		_mapChanged = false;
 	}
 
-	if (_locationsKey) {
-		_readLocations();
-	}
+	_locationsWereRead = false;
 	if (_reportSpamStatusesKey) {
 		_readReportSpamStatuses();
 	}
@@ -2268,6 +2360,8 @@ void reset() {
 	_fileLocations.clear();
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
+	_partialDownloads.clear();
+	_partialUploads.clear();
 	_imagesMap.clear();
 	_draftsNotReadMap.clear();
 	_stickerImagesMap.clear();
@@ -2505,6 +2599,8 @@ bool hasDraft(const PeerId &peer) {
 void writeFileLocation(MediaKey location, const FileLocation &local) {
 	if (local.fname.isEmpty()) return;
 
+	_ensureLocationsRead();
+
 	FileLocationAliases::const_iterator aliasIt = _fileLocationAliases.constFind(location);
 	if (aliasIt != _fileLocationAliases.cend()) {
 		location = aliasIt.value();
@@ -2535,6 +2631,8 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 }
 
 FileLocation readFileLocation(MediaKey location, bool check) {
+	_ensureLocationsRead();
+
 	FileLocationAliases::const_iterator aliasIt = _fileLocationAliases.constFind(location);
 	if (aliasIt != _fileLocationAliases.cend()) {
 		location = aliasIt.value();
@@ -2555,6 +2653,75 @@ FileLocation readFileLocation(MediaKey location, bool check) {
 	return FileLocation();
 }
 
+void writePartialDownload(MediaKey location, const PartialDownload &partial) {
+	if (partial.fname.isEmpty()) return;
+
+	_ensureLocationsRead();
+
+	PartialDownloads::iterator i = _partialDownloads.find(location);
+	if (i != _partialDownloads.cend() && i.value().fname == partial.fname && i.value().offset == partial.offset) {
+		return;
+	}
+	_partialDownloads.insert(location, partial);
+	_writeLocations();
+}
+
+PartialDownload readPartialDownload(MediaKey location) {
+	_ensureLocationsRead();
+
+	PartialDownloads::iterator i = _partialDownloads.find(location);
+	if (i == _partialDownloads.cend()) {
+		return PartialDownload();
+	}
+	if (!QFileInfo(i.value().fname).exists()) {
+		_partialDownloads.erase(i);
+		_writeLocations();
+		return PartialDownload();
+	}
+	return i.value();
+}
+
+void clearPartialDownload(MediaKey location) {
+	_ensureLocationsRead();
+
+	if (_partialDownloads.remove(location)) {
+		_writeLocations();
+	}
+}
+
+void writePartialUpload(const QString &path, const PartialUpload &partial) {
+	if (path.isEmpty()) return;
+
+	_ensureLocationsRead();
+
+	_partialUploads.insert(path, partial);
+	_writeLocations();
+}
+
+PartialUpload readPartialUpload(const QString &path) {
+	_ensureLocationsRead();
+
+	PartialUploads::iterator i = _partialUploads.find(path);
+	if (i == _partialUploads.cend()) {
+		return PartialUpload();
+	}
+	QFileInfo info(path);
+	if (!info.exists() || info.size() != i.value().size || info.lastModified() != i.value().modified || i.value().updated.secsTo(QDateTime::currentDateTime()) > UploadResumeTimeout) {
+		_partialUploads.erase(i);
+		_writeLocations();
+		return PartialUpload();
+	}
+	return i.value();
+}
+
+void clearPartialUpload(const QString &path) {
+	_ensureLocationsRead();
+
+	if (_partialUploads.remove(path)) {
+		_writeLocations();
+	}
+}
+
 qint32 _storageImageSize(qint32 rawlen) {
 	// fulllen + storagekey + type + len + data
 	qint32 result = sizeof(uint32) + sizeof(quint64) * 2 + sizeof(quint32) + sizeof(quint32) + rawlen;
@@ -2563,6 +2730,11 @@ qint32 _storageImageSize(qint32 rawlen) {
 	return result;
 }
 
+StorageKey _stickerRenditionKey(uint64 documentId, const QSize &size) {
+	// real sticker locations never have the high bits of the first part set
+	return StorageKey((0xFFFFULL << 48) | (uint64(size.width() & 0xFFFFFF) << 24) | uint64(size.height() & 0xFFFFFF), documentId);
+}
+
 qint32 _storageStickerSize(qint32 rawlen) {
 	// fulllen + storagekey + len + data
 	qint32 result = sizeof(uint32) + sizeof(quint64) * 2 + sizeof(quint32) + rawlen;
@@ -2790,6 +2962,127 @@ bool copyStickerImage(const StorageKey &oldLocation, const StorageKey &newLocati
 	return true;
 }
 
+// The PNG is encoded and written in the local loader thread,
+// only the map is changed here.
+class StickerRenditionWriteTask : public Task {
+public:
+	StickerRenditionWriteTask(const FileKey &key, const StorageKey &location, const QImage &image) :
+	_key(key), _location(location), _image(image) {
+	}
+	void process() {
+		QByteArray png;
+		{
+			QBuffer buffer(&png);
+			if (!_image.save(&buffer, "PNG")) {
+				return;
+			}
+		}
+		EncryptedDescriptor data(sizeof(quint64) * 2 + sizeof(quint32) + png.size());
+		data.stream << quint64(_location.first) << quint64(_location.second) << png;
+		FileWriteDescriptor file(_key, UserPath);
+		_written = file.writeEncrypted(data);
+		_size = _storageStickerSize(png.size());
+	}
+	void finish() {
+		auto j = _stickerImagesMap.find(_location);
+		if (j == _stickerImagesMap.cend() || j->first != _key) { // the stickers were cleared while writing
+			clearKey(_key, UserPath);
+			return;
+		}
+		if (!_written) {
+			clearKey(_key, UserPath);
+			_storageStickersSize -= j->second;
+			_stickerImagesMap.erase(j);
+			_mapChanged = true;
+			_writeMap();
+			return;
+		}
+		_storageStickersSize += _size - j->second;
+		j->second = _size;
+	}
+
+private:
+	FileKey _key;
+	StorageKey _location;
+	QImage _image;
+	bool _written = false;
+	qint32 _size = 0;
+
+};
+
+class StickerRenditionLoadTask : public Task {
+public:
+	StickerRenditionLoadTask(const FileKey &key, const StorageKey &location, DocumentData *document, const QSize &size) :
+	_key(key), _location(location), _document(document), _size(size) {
+	}
+	void process() {
+		FileReadDescriptor file;
+		if (!readEncryptedFile(file, _key, UserPath)) {
+			return;
+		}
+
+		quint64 first, second;
+		QByteArray png;
+		file.stream >> first >> second >> png;
+		if (file.stream.status() != QDataStream::Ok) {
+			return;
+		}
+
+		QByteArray format = "PNG";
+		auto image = App::readImage(png, &format, false);
+		if (image.size() == _size) {
+			_image = std_::move(image);
+		}
+	}
+	void finish() {
+		if (_image.isNull()) {
+			auto j = _stickerImagesMap.find(_location);
+			if (j != _stickerImagesMap.cend() && j->first == _key) {
+				clearKey(_key, UserPath);
+				_storageStickersSize -= j->second;
+				_stickerImagesMap.erase(j);
+				_mapChanged = true;
+				_writeMap();
+			}
+		}
+		_document->stickerRenditionLoaded(_size, std_::move(_image));
+	}
+
+private:
+	FileKey _key;
+	StorageKey _location;
+	DocumentData *_document;
+	QSize _size;
+	QImage _image;
+
+};
+
+void writeStickerRendition(uint64 documentId, const QImage &image) {
+	if (!_working() || !_localLoader || image.isNull()) return;
+
+	auto location = _stickerRenditionKey(documentId, image.size());
+	if (_stickerImagesMap.constFind(location) != _stickerImagesMap.cend()) {
+		return;
+	}
+
+	// The size is set when the file is written.
+	auto i = _stickerImagesMap.insert(location, FileDesc(genKey(UserPath), 0));
+	_mapChanged = true;
+	_writeMap();
+
+	_localLoader->addTask(new StickerRenditionWriteTask(i.value().first, location, image));
+}
+
+bool startStickerRenditionLoad(DocumentData *document, const QSize &size) {
+	auto location = _stickerRenditionKey(document->id, size);
+	auto j = _stickerImagesMap.constFind(location);
+	if (j == _stickerImagesMap.cend() || !_localLoader) {
+		return false;
+	}
+	_localLoader->addTask(new StickerRenditionLoadTask(j.value().first, location, document, size));
+	return true;
+}
+
 int32 hasStickers() {
 	return _stickerImagesMap.size();
 }
@@ -2879,6 +3172,8 @@ qint32 _storageWebFileSize(const QString &url, qint32 rawlen) {
 void writeWebFile(const QString &url, const QByteArray &content, bool overwrite) {
 	if (!_working()) return;
 
+	_ensureLocationsRead();
+
 	qint32 size = _storageWebFileSize(url, content.size());
 	WebFilesMap::const_iterator i = _webFilesMap.constFind(url);
 	if (i == _webFilesMap.cend()) {
@@ -2957,6 +3252,8 @@ protected:
 };
 
 TaskId startWebFileLoad(const QString &url, webFileLoader *loader) {
+	_ensureLocationsRead();
+
 	WebFilesMap::const_iterator j = _webFilesMap.constFind(url);
 	if (j == _webFilesMap.cend() || !_localLoader) {
 		return 0;
@@ -2965,10 +3262,12 @@ TaskId startWebFileLoad(const QString &url, webFileLoader *loader) {
 }
 
 int32 hasWebFiles() {
+	_ensureLocationsRead();
 	return _webFilesMap.size();
 }
 
 qint64 storageWebFilesSize() {
+	_ensureLocationsRead();
 	return _storageWebFilesSize;
 }
 
@@ -4216,6 +4515,7 @@ bool ClearManager::addTask(int task) {
 				_storageStickersSize = 0;
 				_mapChanged = true;
 			}
+			_ensureLocationsRead();
 			if (data->webFiles.isEmpty()) {
 				data->webFiles = _webFilesMap;
 			} else {
@@ -98,6 +98,28 @@ bool hasDraft(const PeerId &peer);
 void writeFileLocation(MediaKey location, const FileLocation &local);
 FileLocation readFileLocation(MediaKey location, bool check = true);
 
+// Document downloaded straight to a file, resumed from offset after a restart.
+struct PartialDownload {
+	QString fname;
+	qint32 offset = 0;
+};
+void writePartialDownload(MediaKey location, const PartialDownload &partial);
+PartialDownload readPartialDownload(MediaKey location);
+void clearPartialDownload(MediaKey location);
+
+// Big file upload, resumed from the first part not acked by the server.
+struct PartialUpload {
+	quint64 fileId = 0;
+	qint32 size = 0;
+	QDateTime modified;
+	qint32 partSize = 0;
+	qint32 partsUploaded = 0;
+	QDateTime updated;
+};
+void writePartialUpload(const QString &path, const PartialUpload &partial);
+PartialUpload readPartialUpload(const QString &path);
+void clearPartialUpload(const QString &path);
+
 void writeImage(const StorageKey &location, const ImagePtr &img);
 void writeImage(const StorageKey &location, const StorageImageSaved &jpeg, bool overwrite = true);
 TaskId startImageLoad(const StorageKey &location, mtpFileLoader *loader);
@@ -108,6 +130,12 @@ void writeStickerImage(const StorageKey &location, const QByteArray &data, bool
 TaskId startStickerImageLoad(const StorageKey &location, mtpFileLoader *loader);
 bool willStickerImageLoad(const StorageKey &location);
 bool copyStickerImage(const StorageKey &oldLocation, const StorageKey &newLocation);
+
+// Scaled sticker images are kept with the stickers as PNG, by document id and size in pixels.
+// They are written and read in the local loader thread, a loaded rendition is
+// passed to DocumentData::stickerRenditionLoaded(), returns false if there is none.
+void writeStickerRendition(uint64 documentId, const QImage &image);
+bool startStickerRenditionLoad(DocumentData *document, const QSize &size);
 int32 hasStickers();
 qint64 storageStickersSize();
 
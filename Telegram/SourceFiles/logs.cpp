@@ -513,6 +513,36 @@ namespace Logs {
 		_logsWrite(LogDataMtp, msg);
 	}
 
+	namespace {
+		struct StartupPhase {
+			const char *name;
+			uint64 ms;
+		};
+		QVector<StartupPhase> StartupPhases;
+		bool StartupPhasesFinished = false;
+	}
+
+	void startupPhase(const char *name) {
+		if (StartupPhasesFinished) return;
+
+		StartupPhases.push_back({ name, getms() });
+	}
+
+	void startupFinished() {
+		if (StartupPhasesFinished) return;
+
+		startupPhase("first frame");
+		StartupPhasesFinished = true;
+
+		auto startMs = StartupPhases.front().ms, previousMs = startMs;
+		for_const (auto &phase, StartupPhases) {
+			LOG(("Startup: %1 took %2 ms, done at %3 ms").arg(phase.name).arg(phase.ms - previousMs).arg(phase.ms - startMs));
+			previousMs = phase.ms;
+		}
+		StartupPhases.clear();
+		StartupPhases.squeeze();
+	}
+
 	QString full() {
 		if (LogsData) {
 			return LogsData->full();
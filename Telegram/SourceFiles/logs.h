@@ -38,6 +38,11 @@ namespace Logs {
 	void writeTcp(const QString &v);
 	void writeMtp(int32 dc, const QString &v);
 
+	// Startup phases are collected in memory and written to the main log
+	// as one timeline when the first frame of the app is about to be shown.
+	void startupPhase(const char *name);
+	void startupFinished();
+
 	QString full();
 
 	inline const char *b(bool v) {
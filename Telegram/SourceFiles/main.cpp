@@ -41,9 +41,12 @@ int main(int argc, char *argv[]) {
 #endif // !TDESKTOP_DISABLE_CRASH_REPORTS
 	}
 
+	Logs::startupPhase("launch");
+
 	// both are finished in Application::closeApplication
 	Logs::start(); // must be started before Platform is started
 	Platform::start(); // must be started before QApplication is created
+	Logs::startupPhase("logs and platform");
 
 	int result = 0;
 	{
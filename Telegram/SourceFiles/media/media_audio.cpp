@@ -875,6 +875,31 @@ AudioPlaybackState AudioPlayer::currentVideoState(uint64 videoPlayId) {
 	return current->playbackState;
 }
 
+QString AudioPlayer::memoryReport() {
+	QMutexLocker lock(&playerMutex);
+	auto tracks = 0;
+	auto fileBytes = int64(0), bufferBytes = int64(0);
+	auto countTrack = [&](const AudioMsg &data) {
+		if (!data.audio) return;
+
+		++tracks;
+		fileBytes += data.data.size();
+		for (int i = 0; i < 3; ++i) {
+			if (data.samplesCount[i] && alIsBuffer(data.buffers[i])) {
+				ALint size = 0;
+				alGetBufferi(data.buffers[i], AL_SIZE, &size);
+				bufferBytes += size;
+			}
+		}
+	};
+	for (int index = 0; index < AudioSimultaneousLimit; ++index) {
+		countTrack(_audioData[index]);
+		countTrack(_songData[index]);
+	}
+	countTrack(_videoData);
+	return qsl("tracks: %1, files: %2 kb, buffers: %3 kb").arg(tracks).arg(fileBytes / 1024).arg(bufferBytes / 1024);
+}
+
 AudioPlaybackState AudioPlayer::currentState(AudioMsgId *audio, AudioMsgId::Type type) {
 	QMutexLocker lock(&playerMutex);
 	auto current = dataForType(type);
@@ -83,6 +83,9 @@ public:
 
 	void resumeDevice();
 
+	// Tracks with data, loaded file bytes and queued OpenAL buffer bytes.
+	QString memoryReport();
+
 	~AudioPlayer();
 
 private slots:
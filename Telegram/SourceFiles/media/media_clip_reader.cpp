@@ -611,6 +611,20 @@ bool Manager::carries(Reader *reader) const {
 	return _readerPointers.contains(reader);
 }
 
+void Manager::countFrames(int &readers, int64 &bytes) const {
+	QMutexLocker lock(&_readerPointersMutex);
+	for (auto i = _readerPointers.cbegin(), e = _readerPointers.cend(); i != e; ++i) {
+		auto reader = i.key();
+		++readers;
+
+		// Each of the three frames keeps the original image and the prepared pixmap.
+		for (auto &frame : reader->_frames) {
+			bytes += int64(reader->_width) * reader->_height * 4;
+			bytes += int64(frame.request.outerw) * frame.request.outerh * 4;
+		}
+	}
+}
+
 Manager::ReaderPointers::iterator Manager::unsafeFindReaderPointer(ReaderPrivate *reader) {
 	ReaderPointers::iterator it = _readerPointers.find(reader->_interface);
 
@@ -871,5 +885,14 @@ void Finish() {
 	}
 }
 
+QString MemoryReport() {
+	auto readers = 0;
+	auto bytes = int64(0);
+	for_const (auto manager, managers) {
+		manager->countFrames(readers, bytes);
+	}
+	return qsl("threads: %1, readers: %2, frames: ~%3 kb").arg(threads.size()).arg(readers).arg(bytes / 1024);
+}
+
 } // namespace Clip
 } // namespace Media
@@ -200,6 +200,7 @@ public:
 	void update(Reader *reader);
 	void stop(Reader *reader);
 	bool carries(Reader *reader) const;
+	void countFrames(int &readers, int64 &bytes) const;
 	~Manager();
 
 signals:
@@ -245,5 +246,8 @@ MTPDocumentAttribute readAttributes(const QString &fname, const QByteArray &data
 
 void Finish();
 
+// Readers count and an estimate of their frame buffers, from the main thread.
+QString MemoryReport();
+
 } // namespace Clip
 } // namespace Media
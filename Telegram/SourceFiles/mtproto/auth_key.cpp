@@ -24,9 +24,226 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 
 #include <openssl/aes.h>
 
+#ifdef Q_PROCESSOR_X86
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MTP_AESNI_TARGET
+#else // _MSC_VER
+#include <cpuid.h>
+#define MTP_AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+#endif // Q_PROCESSOR_X86
+
 namespace MTP {
+namespace {
 
-void aesIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+#ifdef Q_PROCESSOR_X86
+
+// OpenSSL AES_ige_encrypt() and AES_ctr128_encrypt() go through the
+// table based AES_encrypt() / AES_decrypt() even on cpus with AES-NI,
+// so we do the block cipher with AES-NI ourselves when it is available.
+bool detectAesNi() {
+#ifdef _MSC_VER
+	int info[4] = { 0 };
+	__cpuid(info, 1);
+	return (info[2] & (1 << 25)) != 0;
+#else // _MSC_VER
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1U << 25));
+#endif // _MSC_VER
+}
+
+constexpr int kAes256Rounds = 14;
+
+struct AesNiSchedule {
+	__m128i keys[kAes256Rounds + 1];
+};
+
+MTP_AESNI_TARGET inline __m128i aesNiExpandEven(__m128i key, __m128i assist) {
+	assist = _mm_shuffle_epi32(assist, 0xff);
+	auto shifted = _mm_slli_si128(key, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	shifted = _mm_slli_si128(shifted, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	shifted = _mm_slli_si128(shifted, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	return _mm_xor_si128(key, assist);
+}
+
+MTP_AESNI_TARGET inline __m128i aesNiExpandOdd(__m128i even, __m128i key) {
+	auto assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(even, 0x00), 0xaa);
+	auto shifted = _mm_slli_si128(key, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	shifted = _mm_slli_si128(shifted, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	shifted = _mm_slli_si128(shifted, 0x04);
+	key = _mm_xor_si128(key, shifted);
+	return _mm_xor_si128(key, assist);
+}
+
+MTP_AESNI_TARGET void aesNiEncryptSchedule(const void *key, AesNiSchedule &result) {
+	auto k = result.keys;
+	k[0] = _mm_loadu_si128(static_cast<const __m128i*>(key));
+	k[1] = _mm_loadu_si128(static_cast<const __m128i*>(key) + 1);
+
+	// _mm_aeskeygenassist_si128() wants the round constant to be an immediate.
+	k[2] = aesNiExpandEven(k[0], _mm_aeskeygenassist_si128(k[1], 0x01));
+	k[3] = aesNiExpandOdd(k[2], k[1]);
+	k[4] = aesNiExpandEven(k[2], _mm_aeskeygenassist_si128(k[3], 0x02));
+	k[5] = aesNiExpandOdd(k[4], k[3]);
+	k[6] = aesNiExpandEven(k[4], _mm_aeskeygenassist_si128(k[5], 0x04));
+	k[7] = aesNiExpandOdd(k[6], k[5]);
+	k[8] = aesNiExpandEven(k[6], _mm_aeskeygenassist_si128(k[7], 0x08));
+	k[9] = aesNiExpandOdd(k[8], k[7]);
+	k[10] = aesNiExpandEven(k[8], _mm_aeskeygenassist_si128(k[9], 0x10));
+	k[11] = aesNiExpandOdd(k[10], k[9]);
+	k[12] = aesNiExpandEven(k[10], _mm_aeskeygenassist_si128(k[11], 0x20));
+	k[13] = aesNiExpandOdd(k[12], k[11]);
+	k[14] = aesNiExpandEven(k[12], _mm_aeskeygenassist_si128(k[13], 0x40));
+}
+
+MTP_AESNI_TARGET void aesNiDecryptSchedule(const void *key, AesNiSchedule &result) {
+	AesNiSchedule encrypt;
+	aesNiEncryptSchedule(key, encrypt);
+
+	result.keys[0] = encrypt.keys[kAes256Rounds];
+	for (int i = 1; i < kAes256Rounds; ++i) {
+		result.keys[i] = _mm_aesimc_si128(encrypt.keys[kAes256Rounds - i]);
+	}
+	result.keys[kAes256Rounds] = encrypt.keys[0];
+}
+
+MTP_AESNI_TARGET inline __m128i aesNiEncryptBlock(__m128i block, const AesNiSchedule &schedule) {
+	block = _mm_xor_si128(block, schedule.keys[0]);
+	for (int i = 1; i < kAes256Rounds; ++i) {
+		block = _mm_aesenc_si128(block, schedule.keys[i]);
+	}
+	return _mm_aesenclast_si128(block, schedule.keys[kAes256Rounds]);
+}
+
+MTP_AESNI_TARGET inline __m128i aesNiDecryptBlock(__m128i block, const AesNiSchedule &schedule) {
+	block = _mm_xor_si128(block, schedule.keys[0]);
+	for (int i = 1; i < kAes256Rounds; ++i) {
+		block = _mm_aesdec_si128(block, schedule.keys[i]);
+	}
+	return _mm_aesdeclast_si128(block, schedule.keys[kAes256Rounds]);
+}
+
+// IGE chaining is the same as in OpenSSL: iv holds the previous ciphertext
+// block followed by the previous plaintext block. Both directions are serial,
+// each block is loaded before the output is stored, so src == dst works.
+MTP_AESNI_TARGET void aesNiIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+	AesNiSchedule schedule;
+	aesNiEncryptSchedule(key, schedule);
+
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	auto prevCipher = _mm_loadu_si128(static_cast<const __m128i*>(iv));
+	auto prevPlain = _mm_loadu_si128(static_cast<const __m128i*>(iv) + 1);
+	for (auto blocks = len / AES_BLOCK_SIZE; blocks != 0; --blocks) {
+		auto plain = _mm_loadu_si128(from++);
+		auto cipher = _mm_xor_si128(aesNiEncryptBlock(_mm_xor_si128(plain, prevCipher), schedule), prevPlain);
+		_mm_storeu_si128(to++, cipher);
+		prevCipher = cipher;
+		prevPlain = plain;
+	}
+}
+
+MTP_AESNI_TARGET void aesNiIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+	AesNiSchedule schedule;
+	aesNiDecryptSchedule(key, schedule);
+
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	auto prevCipher = _mm_loadu_si128(static_cast<const __m128i*>(iv));
+	auto prevPlain = _mm_loadu_si128(static_cast<const __m128i*>(iv) + 1);
+	for (auto blocks = len / AES_BLOCK_SIZE; blocks != 0; --blocks) {
+		auto cipher = _mm_loadu_si128(from++);
+		auto plain = _mm_xor_si128(aesNiDecryptBlock(_mm_xor_si128(cipher, prevPlain), schedule), prevCipher);
+		_mm_storeu_si128(to++, plain);
+		prevCipher = cipher;
+		prevPlain = plain;
+	}
+}
+
+// Big endian 128 bit counter increment, like ctr128_inc() in OpenSSL.
+inline void ctrIncrement(uchar *counter) {
+	for (int i = CTRState::IvecSize; i != 0;) {
+		if (++counter[--i]) {
+			return;
+		}
+	}
+}
+
+// Mirrors AES_ctr128_encrypt() behaviour with the ecount / num state,
+// so that the stream can be continued by either implementation.
+// Full blocks are encrypted four counters at a time, the rounds are independent.
+MTP_AESNI_TARGET void aesNiCtrEncrypt(uchar *data, uint32 len, const void *key, CTRState *state) {
+	AesNiSchedule schedule;
+	aesNiEncryptSchedule(key, schedule);
+
+	auto n = state->num;
+	while (n && len) {
+		*(data++) ^= state->ecount[n];
+		--len;
+		n = (n + 1) % AES_BLOCK_SIZE;
+	}
+
+	auto ecount = _mm_setzero_si128();
+	auto ecountChanged = false;
+	while (len >= 4 * AES_BLOCK_SIZE) {
+		__m128i counters[4];
+		for (auto &counter : counters) {
+			counter = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state->ivec));
+			ctrIncrement(state->ivec);
+		}
+		for (auto &counter : counters) {
+			counter = _mm_xor_si128(counter, schedule.keys[0]);
+		}
+		for (int i = 1; i < kAes256Rounds; ++i) {
+			for (auto &counter : counters) {
+				counter = _mm_aesenc_si128(counter, schedule.keys[i]);
+			}
+		}
+		for (auto &counter : counters) {
+			counter = _mm_aesenclast_si128(counter, schedule.keys[kAes256Rounds]);
+			auto block = reinterpret_cast<__m128i*>(data);
+			_mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), counter));
+			data += AES_BLOCK_SIZE;
+		}
+		ecount = counters[3];
+		ecountChanged = true;
+		len -= 4 * AES_BLOCK_SIZE;
+	}
+	while (len >= AES_BLOCK_SIZE) {
+		ecount = aesNiEncryptBlock(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state->ivec)), schedule);
+		ctrIncrement(state->ivec);
+		ecountChanged = true;
+		auto block = reinterpret_cast<__m128i*>(data);
+		_mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), ecount));
+		data += AES_BLOCK_SIZE;
+		len -= AES_BLOCK_SIZE;
+	}
+	if (len) {
+		ecount = aesNiEncryptBlock(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state->ivec)), schedule);
+		ctrIncrement(state->ivec);
+		ecountChanged = true;
+	}
+	if (ecountChanged) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state->ecount), ecount);
+	}
+	while (len--) {
+		data[n] ^= state->ecount[n];
+		++n;
+	}
+	state->num = n;
+}
+
+#endif // Q_PROCESSOR_X86
+
+void opensslIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
 	uchar aes_key[32], aes_iv[32];
 	memcpy(aes_key, key, 32);
 	memcpy(aes_iv, iv, 32);
@@ -36,7 +253,7 @@ void aesIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, cons
 	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_ENCRYPT);
 }
 
-void aesIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+void opensslIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
 	uchar aes_key[32], aes_iv[32];
 	memcpy(aes_key, key, 32);
 	memcpy(aes_iv, iv, 32);
@@ -46,14 +263,113 @@ void aesIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, cons
 	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_DECRYPT);
 }
 
-void aesCtrEncrypt(void *data, uint32 len, const void *key, CTRState *state) {
+void opensslCtrEncrypt(void *data, uint32 len, const void *key, CTRState *state) {
 	AES_KEY aes;
 	AES_set_encrypt_key(static_cast<const uchar*>(key), 256, &aes);
 
+	AES_ctr128_encrypt(static_cast<const uchar*>(data), static_cast<uchar*>(data), len, &aes, state->ivec, state->ecount, &state->num);
+}
+
+#ifdef Q_PROCESSOR_X86
+
+// Encrypts a fixed vector with both implementations, the AES-NI code is used
+// only if the results are the same: IGE both ways, in place and not, and
+// CTR in several calls that start and end in the middle of a block.
+bool aesNiSelfTest() {
+	constexpr int kBlocks = 11;
+	uchar key[32], iv[32], plain[kBlocks * AES_BLOCK_SIZE];
+	for (int i = 0; i != sizeof(key); ++i) key[i] = uchar(i * 7 + 1);
+	for (int i = 0; i != sizeof(iv); ++i) iv[i] = uchar(0xA5 ^ (i * 13));
+	for (int i = 0; i != sizeof(plain); ++i) plain[i] = uchar(i * 31 + 17);
+
+	uchar expected[sizeof(plain)], result[sizeof(plain)];
+	opensslIgeEncrypt(plain, expected, sizeof(plain), key, iv);
+	aesNiIgeEncrypt(plain, result, sizeof(plain), key, iv);
+	if (memcmp(expected, result, sizeof(result))) {
+		return false;
+	}
+	aesNiIgeDecrypt(expected, result, sizeof(plain), key, iv);
+	if (memcmp(plain, result, sizeof(result))) {
+		return false;
+	}
+	memcpy(result, plain, sizeof(result));
+	aesNiIgeEncrypt(result, result, sizeof(result), key, iv);
+	if (memcmp(expected, result, sizeof(result))) {
+		return false;
+	}
+	aesNiIgeDecrypt(result, result, sizeof(result), key, iv);
+	if (memcmp(plain, result, sizeof(result))) {
+		return false;
+	}
+
+	CTRState expectedState, resultState;
+	memcpy(expectedState.ivec, iv, CTRState::IvecSize);
+	expectedState.ivec[CTRState::IvecSize - 1] = 0xFE; // the counter carries to the next byte
+	resultState = expectedState;
+	memcpy(expected, plain, sizeof(expected));
+	memcpy(result, plain, sizeof(result));
+	const uint32 parts[] = { 7, 9 + 4 * AES_BLOCK_SIZE + 3, 2 * AES_BLOCK_SIZE, 20 }; // the second one uses the four blocks loop
+	auto offset = uint32(0);
+	for (auto part : parts) {
+		opensslCtrEncrypt(expected + offset, part, key, &expectedState);
+		aesNiCtrEncrypt(result + offset, part, key, &resultState);
+		offset += part;
+	}
+	static_assert(7 + 9 + 4 * AES_BLOCK_SIZE + 3 + 2 * AES_BLOCK_SIZE + 20 <= kBlocks * AES_BLOCK_SIZE, "Too long ctr self test!");
+	return !memcmp(expected, result, offset)
+		&& !memcmp(expectedState.ivec, resultState.ivec, CTRState::IvecSize)
+		&& !memcmp(expectedState.ecount, resultState.ecount, CTRState::EcountSize)
+		&& (expectedState.num == resultState.num);
+}
+
+bool hasAesNi() {
+	static const bool result = [] {
+		if (!detectAesNi()) {
+			return false;
+		} else if (!aesNiSelfTest()) {
+			LOG(("MTP Error: AES-NI self test failed, using OpenSSL for AES."));
+			return false;
+		}
+		return true;
+	}();
+	return result;
+}
+
+#endif // Q_PROCESSOR_X86
+
+} // namespace
+
+void aesIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+#ifdef Q_PROCESSOR_X86
+	if (hasAesNi()) {
+		return aesNiIgeEncrypt(src, dst, len, key, iv);
+	}
+#endif // Q_PROCESSOR_X86
+
+	opensslIgeEncrypt(src, dst, len, key, iv);
+}
+
+void aesIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv) {
+#ifdef Q_PROCESSOR_X86
+	if (hasAesNi()) {
+		return aesNiIgeDecrypt(src, dst, len, key, iv);
+	}
+#endif // Q_PROCESSOR_X86
+
+	opensslIgeDecrypt(src, dst, len, key, iv);
+}
+
+void aesCtrEncrypt(void *data, uint32 len, const void *key, CTRState *state) {
 	static_assert(CTRState::IvecSize == AES_BLOCK_SIZE, "Wrong size of ctr ivec!");
 	static_assert(CTRState::EcountSize == AES_BLOCK_SIZE, "Wrong size of ctr ecount!");
 
-	AES_ctr128_encrypt(static_cast<const uchar*>(data), static_cast<uchar*>(data), len, &aes, state->ivec, state->ecount, &state->num);
+#ifdef Q_PROCESSOR_X86
+	if (hasAesNi()) {
+		return aesNiCtrEncrypt(static_cast<uchar*>(data), len, key, state);
+	}
+#endif // Q_PROCESSOR_X86
+
+	opensslCtrEncrypt(data, len, key, state);
 }
 
 } // namespace MTP
@@ -114,6 +114,12 @@ inline bool operator==(const AuthKey &a, const AuthKey &b) {
 typedef QSharedPointer<AuthKey> AuthKeyPtr;
 typedef QVector<AuthKeyPtr> AuthKeysMap;
 
+struct DhPrime {
+	QByteArray prime;
+	int32 g;
+};
+typedef QVector<DhPrime> DhPrimes;
+
 void aesIgeEncrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv);
 void aesIgeDecrypt(const void *src, void *dst, uint32 len, const void *key, const void *iv);
 
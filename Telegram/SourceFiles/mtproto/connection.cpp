@@ -39,6 +39,12 @@ namespace internal {
 
 namespace {
 
+// Requests taken from each priority in one round of packing a container.
+const int RequestPriorityWeights[RequestPrioritiesCount] = { 4, 2, 1 };
+
+// Max requests of each priority waiting for the response, zero for no limit.
+const int RequestPriorityInFlight[RequestPrioritiesCount] = { 0, MTPBackgroundRequestsInFlight, MTPBulkRequestsInFlight };
+
 bool parsePQ(const string &pqStr, string &pStr, string &qStr) {
 	if (pqStr.length() > 8) return false; // more than 64 bit pq
 
@@ -870,6 +876,8 @@ void ConnectionPrivate::tryToSend() {
 		mtpPreRequestMap toSendDummy, &toSend(prependOnly ? toSendDummy : sessionData->toSendMap());
 		if (prependOnly) locker1.unlock();
 
+		mtpPreRequestMap deferred = prependOnly ? mtpPreRequestMap() : deferByPriority(toSend);
+
 		uint32 toSendCount = toSend.size();
 		if (pingRequest) ++toSendCount;
 		if (ackRequest) ++toSendCount;
@@ -877,13 +885,19 @@ void ConnectionPrivate::tryToSend() {
 		if (stateRequest) ++toSendCount;
 		if (httpWaitRequest) ++toSendCount;
 
-		if (!toSendCount) return; // nothing to send
+		if (!toSendCount) { // nothing to send
+			if (!deferred.isEmpty()) {
+				toSend = deferred;
+			}
+			return;
+		}
 
 		mtpRequest first = pingRequest ? pingRequest : (ackRequest ? ackRequest : (resendRequest ? resendRequest : (stateRequest ? stateRequest : (httpWaitRequest ? httpWaitRequest : toSend.cbegin().value()))));
 		if (toSendCount == 1 && first->msDate > 0) { // if can send without container
 			toSendRequest = first;
+			countQueueingDelay(toSendRequest);
 			if (!prependOnly) {
-				toSend.clear();
+				toSend = deferred;
 				locker1.unlock();
 			}
 
@@ -977,6 +991,7 @@ void ConnectionPrivate::tryToSend() {
 			}
 			for (mtpPreRequestMap::iterator i = toSend.begin(), e = toSend.end(); i != e; ++i) {
 				mtpRequest &req(i.value());
+				countQueueingDelay(req);
 				mtpMsgId msgId = prepareToSend(req, bigMsgId);
 				if (msgId > bigMsgId) msgId = replaceMsgId(req, bigMsgId);
 				if (msgId >= bigMsgId) bigMsgId = msgid();
@@ -1027,13 +1042,115 @@ void ConnectionPrivate::tryToSend() {
 			*(mtpMsgId*)(haveSentIdsWrap->data() + 4) = contMsgId;
 			(*haveSentIdsWrap)[6] = 0; // for container, msDate = 0, seqNo = 0
 			haveSent.insert(contMsgId, haveSentIdsWrap);
-			toSend.clear();
+			toSend = deferred;
 		}
 	}
 	mtpRequestData::padding(toSendRequest);
 	sendRequest(toSendRequest, needAnyResponse, lockFinished);
 }
 
+mtpPreRequestMap ConnectionPrivate::deferByPriority(mtpPreRequestMap &toSend) {
+	mtpPreRequestMap result;
+	_deferredByLimit = false;
+
+	bool lowPriority = false;
+	for (mtpPreRequestMap::const_iterator i = toSend.cbegin(), e = toSend.cend(); i != e; ++i) {
+		if (i.value()->priority != RequestPriority::Interactive) {
+			lowPriority = true;
+			break;
+		}
+	}
+	if (!lowPriority && toSend.size() <= MTPContainerRequestsLimit) {
+		return result;
+	}
+
+	int32 inFlight[RequestPrioritiesCount] = { 0 };
+	{
+		QReadLocker locker(sessionData->haveSentMutex());
+		const mtpRequestMap &haveSent(sessionData->haveSentMap());
+		for (mtpRequestMap::const_iterator i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) {
+			if (i.value()->requestId && i.value()->msDate) { // not a container or a state request
+				++inFlight[int(i.value()->priority)];
+			}
+		}
+	}
+
+	// Requests chained by invokeAfter are always sent, so that their order is kept.
+	QSet<const mtpRequestData*> chained;
+	for (mtpPreRequestMap::const_iterator i = toSend.cbegin(), e = toSend.cend(); i != e; ++i) {
+		if (i.value()->after) {
+			chained.insert(i.value().data());
+			chained.insert(i.value()->after.data());
+		}
+	}
+
+	QVector<mtpRequestId> queues[RequestPrioritiesCount];
+	int32 left = MTPContainerRequestsLimit;
+	for (mtpPreRequestMap::const_iterator i = toSend.cbegin(), e = toSend.cend(); i != e; ++i) {
+		if (chained.contains(i.value().data())) {
+			--left;
+		} else {
+			queues[int(i.value()->priority)].push_back(i.key());
+		}
+	}
+
+	// Weighted round-robin between the priorities, each limited by the requests in flight.
+	int32 taken[RequestPrioritiesCount] = { 0 };
+	for (bool any = true; any && left > 0;) {
+		any = false;
+		for (int32 priority = 0; priority < RequestPrioritiesCount && left > 0; ++priority) {
+			int32 limit = RequestPriorityInFlight[priority];
+			for (int32 j = 0; j < RequestPriorityWeights[priority] && left > 0 && taken[priority] < queues[priority].size(); ++j) {
+				if (limit && inFlight[priority] >= limit) break;
+
+				++taken[priority];
+				++inFlight[priority];
+				--left;
+				any = true;
+			}
+		}
+	}
+
+	bool deferredByCount = false;
+	for (int32 priority = 0; priority < RequestPrioritiesCount; ++priority) {
+		const QVector<mtpRequestId> &queue(queues[priority]);
+		if (taken[priority] >= queue.size()) continue;
+
+		int32 limit = RequestPriorityInFlight[priority];
+		if (limit && inFlight[priority] >= limit) {
+			_deferredByLimit = true;
+		} else {
+			deferredByCount = true;
+		}
+		for (int32 j = taken[priority], l = queue.size(); j < l; ++j) {
+			result.insert(queue.at(j), toSend.take(queue.at(j)));
+		}
+	}
+	if (!result.isEmpty()) {
+		DEBUG_LOG(("MTP Info: dc %1 deferred %2 requests, sending %3").arg(dc).arg(result.size()).arg(toSend.size()));
+	}
+	if (deferredByCount) { // container is full, send the rest right after it
+		emit needToSendAsync();
+	}
+	return result;
+}
+
+void ConnectionPrivate::countQueueingDelay(const mtpRequest &request) {
+	if (!request->msQueued) return;
+
+	uint64 ms = getms(true), delay = (ms > request->msQueued) ? (ms - request->msQueued) : 0;
+	request->msQueued = 0; // count each request once, not on resending
+
+	QueueingStats &stats(_queueingStats[int(request->priority)]);
+	++stats.count;
+	stats.delaySum += delay;
+	accumulate_max(stats.delayMax, delay);
+	if (stats.count >= MTPQueueingStatsPeriod) {
+		DEBUG_LOG(("MTP Info: dc %1 priority %2 queueing delay for %3 requests, average: %4ms, max: %5ms").arg(dc).arg(int(request->priority)).arg(stats.count).arg(stats.delaySum / stats.count).arg(stats.delayMax));
+		stats = QueueingStats();
+	}
+}
+
 void ConnectionPrivate::retryByTimer() {
 	QReadLocker lockFinished(&sessionDataMutex);
 	if (!sessionData) return;
@@ -1502,6 +1619,11 @@ void ConnectionPrivate::handleReceived() {
 			emit needToReceive();
 		}
 
+		if (_deferredByLimit) { // some requests in flight could be completed
+			_deferredByLimit = false;
+			emit needToSendAsync();
+		}
+
 		if (res < 0) {
 			_needSessionReset = (res < -1);
 
@@ -1947,8 +2069,15 @@ int32 ConnectionPrivate::handleOneReceived(const mtpPrime *from, const mtpPrime
 
 		mtpRequestId requestId = wasSent(reqMsgId.v);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
+			RPCParsedResponsePtr parsed = parseResponse(requestId, response.constData(), response.constData() + response.size());
+
 			QWriteLocker locker(sessionData->haveReceivedMutex());
 			sessionData->haveReceivedMap().insert(requestId, response); // save rpc_result for processing in main mtp thread
+			if (parsed) {
+				sessionData->haveParsedMap().insert(requestId, parsed);
+			} else {
+				sessionData->haveParsedMap().remove(requestId);
+			}
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(reqMsgId.v));
 		}
@@ -2576,15 +2705,21 @@ void ConnectionPrivate::dhParamsAnswered() {
 			return restart();
 		}
 
-		// check that dhPrime and (dhPrime - 1) / 2 are really prime using openssl BIGNUM methods
-		MTP::internal::BigNumPrimeTest bnPrimeTest;
-		if (!bnPrimeTest.isPrimeAndGood(&dhPrime[0], MTPMillerRabinIterCount, dh_inner_data.vg.v)) {
-			LOG(("AuthKey Error: bad dh_prime primality!").arg(dhPrime.length()).arg(g_a.length()));
-			DEBUG_LOG(("AuthKey Error: dh_prime %1").arg(Logs::mb(&dhPrime[0], dhPrime.length()).str()));
-			return restart();
+		QByteArray dhPrimeBytes(dhPrime.data(), dhPrime.size());
+		if (dhPrimeChecked(dhPrimeBytes, dh_inner_data.vg.v)) {
+			DEBUG_LOG(("AuthKey Info: dh_prime with g %1 was already checked").arg(dh_inner_data.vg.v));
+		} else {
+			// check that dhPrime and (dhPrime - 1) / 2 are really prime using openssl BIGNUM methods
+			MTP::internal::BigNumPrimeTest bnPrimeTest;
+			if (!bnPrimeTest.isPrimeAndGood(&dhPrime[0], MTPMillerRabinIterCount, dh_inner_data.vg.v)) {
+				LOG(("AuthKey Error: bad dh_prime primality!").arg(dhPrime.length()).arg(g_a.length()));
+				DEBUG_LOG(("AuthKey Error: dh_prime %1").arg(Logs::mb(&dhPrime[0], dhPrime.length()).str()));
+				return restart();
+			}
+			dhPrimeCheckPassed(dhPrimeBytes, dh_inner_data.vg.v);
 		}
 
-		authKeyStrings->dh_prime = QByteArray(dhPrime.data(), dhPrime.size());
+		authKeyStrings->dh_prime = dhPrimeBytes;
 		authKeyData->g = dh_inner_data.vg.v;
 		authKeyStrings->g_a = QByteArray(g_a.data(), g_a.size());
 		authKeyData->retry_id = MTP_long(0);
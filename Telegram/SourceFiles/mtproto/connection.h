@@ -157,6 +157,10 @@ private:
 	void createConn(bool createIPv4, bool createIPv6);
 	void destroyConn(AbstractConnection **conn = 0); // 0 - destory all
 
+	// Takes the requests which should wait out of toSend, must be locked by toSendMutex().
+	mtpPreRequestMap deferByPriority(mtpPreRequestMap &toSend);
+	void countQueueingDelay(const mtpRequest &request);
+
 	mtpMsgId placeToContainer(mtpRequest &toSendRequest, mtpMsgId &bigMsgId, mtpMsgId *&haveSentArr, mtpRequest &req);
 	mtpMsgId prepareToSend(mtpRequest &request, mtpMsgId currentLastId);
 	mtpMsgId replaceMsgId(mtpRequest &request, mtpMsgId newId);
@@ -194,6 +198,14 @@ private:
 
 	QVector<MTPlong> ackRequestData, resendRequestData;
 
+	bool _deferredByLimit = false; // some requests wait for the responses to the same priority requests
+	struct QueueingStats {
+		uint32 count = 0;
+		uint64 delaySum = 0;
+		uint64 delayMax = 0;
+	};
+	QueueingStats _queueingStats[RequestPrioritiesCount];
+
 	// if badTime received - search for ids in sessionData->haveSent and sessionData->wereAcked and sync time/salt, return true if found
 	bool requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 serverTime, uint64 serverSalt);
 
@@ -29,6 +29,15 @@ namespace MTP {
 typedef int32 DcId;
 typedef int32 ShiftedDcId;
 
+// Lower priority requests get less room in the containers
+// and only a limited count of them waits for the response.
+enum class RequestPriority {
+	Interactive = 0, // the user waits for the result, default
+	Background = 1, // preloading, web pages, peer info updates
+	Bulk = 2, // sticker sets, participants lists and other big loads
+};
+constexpr int RequestPrioritiesCount = 3;
+
 }
 
 typedef int32 mtpPrime;
@@ -65,7 +74,10 @@ public:
 	mtpRequest after;
 	bool needsLayer;
 
-	mtpRequestData(bool/* sure*/) : msDate(0), requestId(0), needsLayer(false) {
+	MTP::RequestPriority priority;
+	uint64 msQueued; // when was added to toSend, for the queueing delay statistics
+
+	mtpRequestData(bool/* sure*/) : msDate(0), requestId(0), needsLayer(false), priority(MTP::RequestPriority::Interactive), msQueued(0) {
 	}
 
 	static mtpRequest prepare(uint32 requestSize, uint32 maxSize = 0) {
@@ -38,6 +38,18 @@ namespace {
 	typedef QMap<int32, AuthKeyPtr> _KeysMapForWrite;
 	_KeysMapForWrite _keysMapForWrite;
 	QMutex _keysMapForWriteMutex;
+
+	typedef QMap<uint64, DhPrime> CheckedDhPrimes; // by sha1 of dh_prime and g
+	CheckedDhPrimes _checkedDhPrimes;
+	QMutex _checkedDhPrimesMutex;
+
+	uint64 dhPrimeHash(const QByteArray &prime, int32 g) {
+		QByteArray data(prime);
+		data.append((const char*)&g, sizeof(g));
+
+		uchar sha1Buffer[20];
+		return *(uint64*)hashSha1(data.constData(), data.size(), sha1Buffer);
+	}
 } // namespace
 
 int32 authed() {
@@ -305,5 +317,35 @@ void setAuthKey(int32 dcId, AuthKeyPtr key) {
 	gDCs.insert(dcId, dc);
 }
 
+bool dhPrimeChecked(const QByteArray &prime, int32 g) {
+	uint64 hash = dhPrimeHash(prime, g);
+
+	QMutexLocker lock(&_checkedDhPrimesMutex);
+	auto i = _checkedDhPrimes.constFind(hash);
+	return (i != _checkedDhPrimes.cend()) && (i->g == g) && (i->prime == prime);
+}
+
+void dhPrimeCheckPassed(const QByteArray &prime, int32 g) {
+	uint64 hash = dhPrimeHash(prime, g);
+
+	QMutexLocker lock(&_checkedDhPrimesMutex);
+	if (!_checkedDhPrimes.contains(hash) && _checkedDhPrimes.size() >= MTPCheckedDhPrimesCount) {
+		_checkedDhPrimes.erase(_checkedDhPrimes.begin());
+	}
+	DhPrime &checked(_checkedDhPrimes[hash]);
+	checked.prime = prime;
+	checked.g = g;
+}
+
+DhPrimes getDhPrimes() {
+	DhPrimes result;
+	QMutexLocker lock(&_checkedDhPrimesMutex);
+	result.reserve(_checkedDhPrimes.size());
+	for_const (const DhPrime &checked, _checkedDhPrimes) {
+		result.push_back(checked);
+	}
+	return result;
+}
+
 } // namespace internal
 } // namespace MTP
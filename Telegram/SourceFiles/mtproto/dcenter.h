@@ -101,6 +101,11 @@ void authed(int32 uid);
 AuthKeysMap getAuthKeys();
 void setAuthKey(int32 dc, AuthKeyPtr key);
 
+// dh_prime and g pairs that passed the primality check are not checked again
+bool dhPrimeChecked(const QByteArray &prime, int32 g);
+void dhPrimeCheckPassed(const QByteArray &prime, int32 g);
+DhPrimes getDhPrimes();
+
 void updateDcOptions(const QVector<MTPDcOption> &options);
 QReadWriteLock *dcOptionsMutex();
 
@@ -508,7 +508,33 @@ void performDelayedClear() {
 	}
 }
 
-void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) {
+RPCParsedResponsePtr parseResponse(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) {
+	if (from >= end || *from == mtpc_rpc_error) {
+		return RPCParsedResponsePtr();
+	}
+
+	// Only the parser is taken, the handler itself must be destroyed in the main thread.
+	RPCResponseParserPtr parser;
+	{
+		QMutexLocker locker(&parserMapLock);
+		ParserMap::const_iterator i = parserMap.constFind(requestId);
+		if (i == parserMap.cend() || !i.value().onDone) {
+			return RPCParsedResponsePtr();
+		}
+		parser = i.value().onDone->parser();
+	}
+	if (!parser) {
+		return RPCParsedResponsePtr();
+	}
+	try {
+		return (*parser)(from, end);
+	} catch (Exception &e) {
+		DEBUG_LOG(("RPC Info: could not parse response for %1 in the connection thread, exception text: %2").arg(requestId).arg(e.what()));
+	}
+	return RPCParsedResponsePtr(); // the main thread will parse it again and report the error
+}
+
+void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end, const RPCParsedResponsePtr &parsed) {
 	RPCResponseHandler h;
 	{
 		QMutexLocker locker(&parserMapLock);
@@ -535,7 +561,11 @@ void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *
 			} else {
 				if (h.onDone) {
 //						t_assert(App::app() != 0);
-					(*h.onDone)(requestId, from, end);
+					if (parsed) {
+						(*h.onDone)(requestId, parsed);
+					} else {
+						(*h.onDone)(requestId, from, end);
+					}
 				}
 			}
 		} catch (Exception &e) {
@@ -829,6 +859,21 @@ int32 state(mtpRequestId requestId) {
 	return MTP::RequestConnecting;
 }
 
+QString buffersMemoryReport() {
+	internal::BuffersUsage usage;
+	for_const (auto session, sessions) {
+		session->countBuffers(usage);
+	}
+	auto sessionRequests = usage.requests;
+	{
+		QReadLocker locker(&requestMapLock);
+		for_const (auto &request, requestMap) {
+			usage.addRequest(request);
+		}
+	}
+	return qsl("sessions: %1, queued and sent requests: %2, stored requests: %3, unprocessed responses: %4, buffers: ~%5 kb").arg(sessions.size()).arg(sessionRequests).arg(usage.requests - sessionRequests).arg(usage.responses).arg(usage.bytes / 1024);
+}
+
 void finish() {
 	for (Sessions::iterator i = sessions.begin(), e = sessions.end(); i != e; ++i) {
 		i.value()->kill();
@@ -900,6 +945,14 @@ void setKey(int32 dc, AuthKeyPtr key) {
 	return internal::setAuthKey(dc, key);
 }
 
+DhPrimes getDhPrimes() {
+	return internal::getDhPrimes();
+}
+
+void setDhPrime(const QByteArray &prime, int32 g) {
+	return internal::dhPrimeCheckPassed(prime, g);
+}
+
 QReadWriteLock *dcOptionsMutex() {
 	return internal::dcOptionsMutex();
 }
@@ -41,7 +41,8 @@ void wrapInvokeAfter(mtpRequest &to, const mtpRequest &from, const mtpRequestMap
 void clearCallbacks(mtpRequestId requestId, int32 errorCode = RPCError::NoError); // 0 - do not toggle onError callback
 void clearCallbacksDelayed(const RPCCallbackClears &requestIds);
 void performDelayedClear();
-void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end);
+RPCParsedResponsePtr parseResponse(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end); // may be called from any thread
+void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end, const RPCParsedResponsePtr &parsed = RPCParsedResponsePtr());
 bool hasCallbacks(mtpRequestId requestId);
 void globalCallback(const mtpPrime *from, const mtpPrime *end);
 void onStateChange(int32 dcWithShift, int32 state);
@@ -150,15 +151,15 @@ int32 dcstate(int32 dc = 0);
 QString dctransport(int32 dc = 0);
 
 template <typename TRequest>
-inline mtpRequestId send(const TRequest &request, RPCResponseHandler callbacks = RPCResponseHandler(), int32 dc = 0, uint64 msCanWait = 0, mtpRequestId after = 0) {
+inline mtpRequestId send(const TRequest &request, RPCResponseHandler callbacks = RPCResponseHandler(), int32 dc = 0, uint64 msCanWait = 0, mtpRequestId after = 0, RequestPriority priority = RequestPriority::Interactive) {
 	if (internal::Session *session = internal::getSession(dc)) {
-		return session->send(request, callbacks, msCanWait, true, !dc, after);
+		return session->send(request, callbacks, msCanWait, true, !dc, after, priority);
 	}
 	return 0;
 }
 template <typename TRequest>
-inline mtpRequestId send(const TRequest &request, RPCDoneHandlerPtr onDone, RPCFailHandlerPtr onFail = RPCFailHandlerPtr(), int32 dc = 0, uint64 msCanWait = 0, mtpRequestId after = 0) {
-	return send(request, RPCResponseHandler(onDone, onFail), dc, msCanWait, after);
+inline mtpRequestId send(const TRequest &request, RPCDoneHandlerPtr onDone, RPCFailHandlerPtr onFail = RPCFailHandlerPtr(), int32 dc = 0, uint64 msCanWait = 0, mtpRequestId after = 0, RequestPriority priority = RequestPriority::Interactive) {
+	return send(request, RPCResponseHandler(onDone, onFail), dc, msCanWait, after, priority);
 }
 inline void sendAnything(int32 dc = 0, uint64 msCanWait = 0) {
 	if (internal::Session *session = internal::getSession(dc)) {
@@ -177,6 +178,8 @@ enum {
 };
 int32 state(mtpRequestId req); // < 0 means waiting for such count of ms
 
+QString buffersMemoryReport(); // requests and responses held by all sessions
+
 void finish();
 
 void setAuthedId(int32 uid);
@@ -194,6 +197,9 @@ void updateDcOptions(const QVector<MTPDcOption> &options);
 AuthKeysMap getKeys();
 void setKey(int32 dc, AuthKeyPtr key);
 
+DhPrimes getDhPrimes();
+void setDhPrime(const QByteArray &prime, int32 g);
+
 QReadWriteLock *dcOptionsMutex();
 
 struct DcOption {
@@ -210,7 +216,7 @@ typedef QMap<int, DcOption> DcOptions;
 namespace internal {
 
 	template <typename TRequest>
-	mtpRequestId Session::send(const TRequest &request, RPCResponseHandler callbacks, uint64 msCanWait, bool needsLayer, bool toMainDC, mtpRequestId after) {
+	mtpRequestId Session::send(const TRequest &request, RPCResponseHandler callbacks, uint64 msCanWait, bool needsLayer, bool toMainDC, mtpRequestId after, RequestPriority priority) {
 		mtpRequestId requestId = 0;
 		try {
 			uint32 requestSize = request.innerLength() >> 2;
@@ -220,7 +226,9 @@ namespace internal {
 			DEBUG_LOG(("MTP Info: adding request to toSendMap, msCanWait %1").arg(msCanWait));
 
 			reqSerialized->msDate = getms(true); // > 0 - can send without container
+			reqSerialized->msQueued = reqSerialized->msDate;
 			reqSerialized->needsLayer = needsLayer;
+			reqSerialized->priority = priority;
 			if (after) reqSerialized->after = MTP::internal::getRequest(after);
 			requestId = MTP::internal::storeRequest(reqSerialized, callbacks);
 
@@ -217,7 +217,7 @@ void FileLoader::start(bool loadFirst, bool prior) {
 	}
 
 	if (!_fname.isEmpty() && _toCache == LoadToFileOnly && !_fileIsOpen) {
-		_fileIsOpen = _file.open(QIODevice::WriteOnly);
+		_fileIsOpen = openFile();
 		if (!_fileIsOpen) {
 			return cancel(true);
 		}
@@ -324,6 +324,7 @@ void FileLoader::cancel(bool fail) {
 		_file.close();
 		_fileIsOpen = false;
 		_file.remove();
+		clearPartial();
 	}
 	_data = QByteArray();
 	if (fail) {
@@ -427,6 +428,7 @@ bool mtpFileLoader::loadPart() {
 	++_queue->queries;
 	dr.v[dcIndex] += limit;
 	_requests.insert(reqId, dcIndex);
+	_requestedOffsets.insert(offset);
 	_nextRequestOffset += limit;
 
 	if (DebugLogging::FileLoader() && _id) DEBUG_LOG(("FileLoader(%1): requested part with offset=%2, _queue->queries=%3, _nextRequestOffset=%4, _requests=%5").arg(_id).arg(offset).arg(_queue->queries).arg(_nextRequestOffset).arg(serializereqs(_requests)));
@@ -451,6 +453,7 @@ void mtpFileLoader::partLoaded(int32 offset, const MTPupload_File &result, mtpRe
 
 	--_queue->queries;
 	_requests.erase(i);
+	_requestedOffsets.remove(offset);
 
 	auto &d = result.c_upload_file();
 	auto &bytes = d.vbytes.c_string().v;
@@ -506,6 +509,7 @@ void mtpFileLoader::partLoaded(int32 offset, const MTPupload_File &result, mtpRe
 			_fileIsOpen = false;
 			psPostprocessFile(QFileInfo(_file).absoluteFilePath());
 		}
+		clearPartial();
 		removeFromQueue();
 
 		if (!_queue->queries) {
@@ -531,6 +535,9 @@ void mtpFileLoader::partLoaded(int32 offset, const MTPupload_File &result, mtpRe
 		}
 	} else {
 		if (DebugLogging::FileLoader() && _id) DEBUG_LOG(("FileLoader(%1): not done yet, _lastComplete=%2, _size=%3, _nextRequestOffset=%4, _requests=%5").arg(_id).arg(Logs::b(_lastComplete)).arg(_size).arg(_nextRequestOffset).arg(serializereqs(_requests)));
+		if (bytes.size()) {
+			savePartial();
+		}
 	}
 	emit progress(this);
 	if (_complete) {
@@ -558,12 +565,72 @@ void mtpFileLoader::cancelRequests() {
 	}
 	_queue->queries -= _requests.size();
 	_requests.clear();
+	_requestedOffsets.clear();
 
 	if (!_queue->queries && App::app()) {
 		App::app()->killDownloadSessionsStart(_dc);
 	}
 }
 
+bool mtpFileLoader::resumable() const {
+	return !_location && _id && _size > 0 && _locationType != UnknownFileLocation && _toCache == LoadToFileOnly && !_fname.isEmpty();
+}
+
+bool mtpFileLoader::openFile() {
+	if (!resumable()) {
+		return FileLoader::openFile();
+	}
+
+	MediaKey mkey = mediaKey(_locationType, _dc, _id, _version);
+	Local::PartialDownload partial = Local::readPartialDownload(mkey);
+	if (partial.fname.isEmpty()) {
+		return FileLoader::openFile();
+	}
+
+	// Only the bytes that really reached the disk can be kept, and requests must stay part-aligned.
+	int32 offset = qMin(int64(partial.offset), QFileInfo(partial.fname).size());
+	offset = (offset / DocumentDownloadPartSize) * DocumentDownloadPartSize;
+	if (offset > 0 && offset < _size && QFileInfo(partial.fname).absoluteFilePath() != QFileInfo(_fname).absoluteFilePath()) {
+		QFile::remove(_fname);
+		if (!QFile::rename(partial.fname, _fname)) {
+			offset = 0;
+		}
+	}
+	if (offset <= 0 || offset >= _size || !_file.open(QIODevice::ReadWrite)) {
+		Local::clearPartialDownload(mkey);
+		return FileLoader::openFile();
+	}
+	if (!_file.resize(offset) || !_file.seek(offset)) {
+		_file.close();
+		Local::clearPartialDownload(mkey);
+		return FileLoader::openFile();
+	}
+
+	DEBUG_LOG(("FileLoader(%1): resuming download from offset=%2").arg(_id).arg(offset));
+	_nextRequestOffset = offset;
+	return true;
+}
+
+void mtpFileLoader::savePartial() {
+	if (!_fileIsOpen || !resumable()) return;
+
+	// Everything before the first part still being requested is on disk.
+	int32 downloaded = _requestedOffsets.isEmpty() ? _nextRequestOffset : _requestedOffsets.first();
+	downloaded = qMin(downloaded, _size);
+	if (downloaded <= 0 || !_file.flush()) return;
+
+	Local::PartialDownload partial;
+	partial.fname = _fname;
+	partial.offset = downloaded;
+	Local::writePartialDownload(mediaKey(_locationType, _dc, _id, _version), partial);
+}
+
+void mtpFileLoader::clearPartial() {
+	if (resumable()) {
+		Local::clearPartialDownload(mediaKey(_locationType, _dc, _id, _version));
+	}
+}
+
 bool mtpFileLoader::tryLoadLocal() {
 	if (_localStatus == LocalNotFound || _localStatus == LocalLoaded || _localStatus == LocalFailed) {
 		return false;
@@ -149,6 +149,9 @@ public:
 	bool started() const {
 		return _inQueue || _paused;
 	}
+	bool lowPriority() const { // was never started with prior = true
+		return started() && !_priority;
+	}
 	bool loadingLocal() const {
 		return (_localStatus == LocalLoading);
 	}
@@ -195,6 +198,11 @@ protected:
 
 	virtual bool tryLoadLocal() = 0;
 	virtual void cancelRequests() = 0;
+	virtual bool openFile() {
+		return _file.open(QIODevice::WriteOnly);
+	}
+	virtual void clearPartial() {
+	}
 
 	void startLoading(bool loadFirst, bool prior);
 	void removeFromQueue();
@@ -252,9 +260,17 @@ public:
 protected:
 	virtual bool tryLoadLocal();
 	virtual void cancelRequests();
+	virtual bool openFile();
+	virtual void clearPartial();
+
+	// Documents loaded straight to a file continue from the
+	// downloaded offset if they were interrupted by an app restart.
+	bool resumable() const;
+	void savePartial();
 
 	typedef QMap<mtpRequestId, int32> Requests;
 	Requests _requests;
+	OrderedSet<int32> _requestedOffsets;
 
 	virtual bool loadPart();
 	void partLoaded(int32 offset, const MTPupload_File &result, mtpRequestId req);
@@ -80,11 +80,61 @@ inline bool isDefaultHandledError(const RPCError &error) {
 
 } // namespace MTP
 
+class RPCAbstractParsedResponse { // response deserialized outside of the main thread
+public:
+	virtual ~RPCAbstractParsedResponse() {
+	}
+};
+typedef QSharedPointer<RPCAbstractParsedResponse> RPCParsedResponsePtr;
+
+template <typename TResponse>
+class RPCParsedResponse : public RPCAbstractParsedResponse {
+public:
+	RPCParsedResponse(const mtpPrime *from, const mtpPrime *end) : value(from, end) {
+	}
+	TResponse value;
+};
+
+class RPCAbstractResponseParser { // abstract parser, does not depend on the handler owner
+public:
+	virtual RPCParsedResponsePtr operator()(const mtpPrime *from, const mtpPrime *end) const = 0;
+	virtual ~RPCAbstractResponseParser() {
+	}
+};
+typedef QSharedPointer<RPCAbstractResponseParser> RPCResponseParserPtr;
+
+template <typename TResponse>
+class RPCResponseParser : public RPCAbstractResponseParser {
+public:
+	RPCParsedResponsePtr operator()(const mtpPrime *from, const mtpPrime *end) const override {
+		return RPCParsedResponsePtr(new RPCParsedResponse<TResponse>(from, end));
+	}
+};
+
 class RPCAbstractDoneHandler { // abstract done
 public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const = 0;
+
+	// Handlers with a typed result can get it already parsed on the connection thread,
+	// this is enabled for the handler by rpcParseAnywhere().
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr();
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+	}
+	void parseAnywhere() {
+		_parser = createParser();
+	}
+	const RPCResponseParserPtr &parser() const {
+		return _parser;
+	}
+
 	virtual ~RPCAbstractDoneHandler() {
 	}
+
+private:
+	RPCResponseParserPtr _parser;
+
 };
 typedef QSharedPointer<RPCAbstractDoneHandler> RPCDoneHandlerPtr;
 
@@ -151,6 +201,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		(*_onDone)(TResponse(from, end));
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		(*_onDone)(static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value);
+	}
 
 private:
 	CallbackType _onDone;
@@ -167,6 +223,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		(*_onDone)(TResponse(from, end), requestId);
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		(*_onDone)(static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value, requestId);
+	}
 
 private:
 	CallbackType _onDone;
@@ -304,6 +366,11 @@ inline RPCDoneHandlerPtr rpcDone(TReturn (*onDone)(mtpRequestId)) { // done(req_
 	return RPCDoneHandlerPtr(new RPCDoneHandlerNoReq<TReturn>(onDone));
 }
 
+inline RPCDoneHandlerPtr rpcParseAnywhere(const RPCDoneHandlerPtr &onDone) { // parse the response on the connection thread
+	onDone->parseAnywhere();
+	return onDone;
+}
+
 inline RPCFailHandlerPtr rpcFail(bool (*onFail)(const RPCError &)) { // fail(error)
 	return RPCFailHandlerPtr(new RPCFailHandlerPlain(onFail));
 }
@@ -388,6 +455,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(TResponse(from, end));
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value);
+	}
 
 private:
 	CallbackType _onDone;
@@ -404,6 +477,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(TResponse(from, end), requestId);
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value, requestId);
+	}
 
 private:
 	CallbackType _onDone;
@@ -486,6 +565,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(_b, TResponse(from, end));
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(_b, static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value);
+	}
 
 private:
 	CallbackType _onDone;
@@ -503,6 +588,12 @@ public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) const {
 		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(_b, TResponse(from, end), requestId);
 	}
+	virtual RPCResponseParserPtr createParser() const {
+		return RPCResponseParserPtr(new RPCResponseParser<TResponse>());
+	}
+	virtual void operator()(mtpRequestId requestId, const RPCParsedResponsePtr &parsed) const {
+		if (_owner) (static_cast<TReceiver*>(_owner)->*_onDone)(_b, static_cast<const RPCParsedResponse<TResponse>*>(parsed.data())->value, requestId);
+	}
 
 private:
 	CallbackType _onDone;
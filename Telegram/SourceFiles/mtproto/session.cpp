@@ -25,6 +25,15 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 namespace MTP {
 namespace internal {
 
+void BuffersUsage::addRequest(const mtpRequest &request) {
+	++requests;
+	auto data = request.data();
+	if (data && !counted.contains(data)) {
+		counted.insert(data);
+		bytes += data->capacity() * sizeof(mtpPrime);
+	}
+}
+
 void SessionData::clear() {
 	RPCCallbackClears clearCallbacks;
 	{
@@ -386,6 +395,28 @@ QString Session::transport() const {
 	return _connection ? _connection->transport() : QString();
 }
 
+void Session::countBuffers(BuffersUsage &usage) const {
+	{
+		QReadLocker locker(data.toSendMutex());
+		for_const (auto &request, data.toSendMap()) {
+			usage.addRequest(request);
+		}
+	}
+	{
+		QReadLocker locker(data.haveSentMutex());
+		for_const (auto &request, data.haveSentMap()) {
+			usage.addRequest(request);
+		}
+	}
+	{
+		QReadLocker locker(data.haveReceivedMutex());
+		for_const (auto &response, data.haveReceivedMap()) {
+			++usage.responses;
+			usage.bytes += response.capacity() * sizeof(mtpPrime);
+		}
+	}
+}
+
 mtpRequestId Session::resend(quint64 msgId, quint64 msCanWait, bool forceContainer, bool sendMsgStateInfo) {
 	mtpRequest request;
 	{
@@ -514,10 +545,16 @@ void Session::tryToReceive() {
 		_needToReceive = true;
 		return;
 	}
-	int32 cnt = 0;
+	uint64 ms = getms(true), till = ms + MTPReceiveFrameBudget;
 	while (true) {
+		if (ms >= till) { // let the event loop run, continue in the next iteration
+			QTimer::singleShot(0, this, SLOT(tryToReceive()));
+			return;
+		}
+
 		mtpRequestId requestId;
 		mtpResponse response;
+		RPCParsedResponsePtr parsed;
 		{
 			QWriteLocker locker(data.haveReceivedMutex());
 			mtpResponseMap &responses(data.haveReceivedMap());
@@ -527,15 +564,22 @@ void Session::tryToReceive() {
 			requestId = i.key();
 			response = i.value();
 			responses.erase(i);
+
+			mtpParsedResponseMap &parsedResponses(data.haveParsedMap());
+			mtpParsedResponseMap::iterator j = parsedResponses.find(requestId);
+			if (j != parsedResponses.end()) {
+				parsed = j.value();
+				parsedResponses.erase(j);
+			}
 		}
 		if (requestId <= 0) {
 			if (dcWithShift == bareDcId(dcWithShift)) { // call globalCallback only in main session
 				globalCallback(response.constData(), response.constData() + response.size());
 			}
 		} else {
-			execCallback(requestId, response.constData(), response.constData() + response.size());
+			execCallback(requestId, response.constData(), response.constData() + response.size(), parsed);
 		}
-		++cnt;
+		ms = getms(true);
 	}
 }
 
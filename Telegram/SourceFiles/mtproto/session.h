@@ -30,6 +30,18 @@ namespace internal {
 
 class Session;
 
+typedef QMap<mtpRequestId, RPCParsedResponsePtr> mtpParsedResponseMap;
+
+struct BuffersUsage {
+	int requests = 0;
+	int responses = 0;
+	int64 bytes = 0;
+
+	// The same request lies in several maps, its buffer is counted once.
+	QSet<const mtpRequestData*> counted;
+	void addRequest(const mtpRequest &request);
+};
+
 class SessionData {
 public:
 	SessionData(Session *creator)
@@ -160,6 +172,9 @@ public:
 	const mtpResponseMap &haveReceivedMap() const {
 		return haveReceived;
 	}
+	mtpParsedResponseMap &haveParsedMap() { // must be locked by haveReceivedMutex()
+		return haveParsed;
+	}
 	mtpMsgIdsSet &stateRequestMap() {
 		return stateRequest;
 	}
@@ -209,6 +224,7 @@ private:
 	mtpMsgIdsMap receivedIds; // set of received msg_id's, for checking new msg_ids
 	mtpRequestIdsMap wereAcked; // map of msg_id -> request_id, this msg_ids already were acked or do not need ack
 	mtpResponseMap haveReceived; // map of request_id -> response, that should be processed in other thread
+	mtpParsedResponseMap haveParsed; // map of request_id -> response, that was already parsed in the connection thread
 	mtpMsgIdsSet stateRequest; // set of msg_id's, whose state should be requested
 
 	// mutexes
@@ -243,13 +259,14 @@ public:
 	void notifyLayerInited(bool wasInited);
 
 	template <typename TRequest>
-	mtpRequestId send(const TRequest &request, RPCResponseHandler callbacks = RPCResponseHandler(), uint64 msCanWait = 0, bool needsLayer = false, bool toMainDC = false, mtpRequestId after = 0); // send mtp request
+	mtpRequestId send(const TRequest &request, RPCResponseHandler callbacks = RPCResponseHandler(), uint64 msCanWait = 0, bool needsLayer = false, bool toMainDC = false, mtpRequestId after = 0, RequestPriority priority = RequestPriority::Interactive); // send mtp request
 
 	void ping();
 	void cancel(mtpRequestId requestId, mtpMsgId msgId);
 	int32 requestState(mtpRequestId requestId) const;
 	int32 getState() const;
 	QString transport() const;
+	void countBuffers(BuffersUsage &usage) const;
 
 	void sendPrepared(const mtpRequest &request, uint64 msCanWait = 0, bool newRequest = true); // nulls msgId and seqNo in request, if newRequest = true
 
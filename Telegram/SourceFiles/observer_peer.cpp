@@ -31,21 +31,39 @@ void emitPeerUpdated();
 namespace Notify {
 namespace {
 
+constexpr int kSendDelayedBudgetMs = 8; // send peer updates for 8ms, then let the event loop run
+
 using SmallUpdatesList = QVector<PeerUpdate>;
 NeverFreedPointer<SmallUpdatesList> SmallUpdates;
 using AllUpdatesList = QMap<PeerData*, PeerUpdate>;
 NeverFreedPointer<AllUpdatesList> AllUpdates;
 
+// Updates taken from the lists, but not sent yet because of the time budget.
+using SendingUpdatesList = QVector<PeerUpdate>;
+NeverFreedPointer<SendingUpdatesList> SendingUpdates;
+
+PeerUpdateStats Stats;
+
 void StartCallback() {
 	SmallUpdates.createIfNull();
 	AllUpdates.createIfNull();
+	SendingUpdates.createIfNull();
 }
 void FinishCallback() {
 	SmallUpdates.clear();
 	AllUpdates.clear();
+	SendingUpdates.clear();
 }
 
-base::Observable<PeerUpdate, PeerUpdatedHandler> PeerUpdatedObservable;
+using PeerUpdatedObservable = base::Observable<PeerUpdate, PeerUpdatedHandler>;
+PeerUpdatedObservable AllPeersUpdatedObservable;
+
+// The observables are created on the first subscription and are never freed,
+// there are not more of them than peers with opened profiles.
+QMap<PeerData*, PeerUpdatedObservable*> PeerUpdatedObservables;
+
+using HandlersStatsSet = OrderedSet<PeerUpdateHandlerStats*>;
+NeverFreedPointer<HandlersStatsSet> HandlersStats;
 
 } // namespace
 
@@ -96,25 +114,102 @@ void peerUpdatedDelayed(const PeerUpdate &update) {
 void peerUpdatedSendDelayed() {
 	App::emitPeerUpdated();
 
-	if (!SmallUpdates || !AllUpdates || SmallUpdates->empty()) return;
+	if (!SmallUpdates || !AllUpdates) return;
+	SendingUpdates.createIfNull();
+
+	// Updates left from the previous call go first, so that the
+	// updates of the same peer are still sent in the right order.
+	if (SendingUpdates->isEmpty()) {
+		if (SmallUpdates->empty()) return;
+
+		auto smallList = base::take(*SmallUpdates);
+		auto allList = base::take(*AllUpdates);
+		SendingUpdates->reserve(smallList.size() + allList.size());
+		for (auto &update : smallList) {
+			SendingUpdates->push_back(std_::move(update));
+		}
+		for (auto &update : allList) {
+			SendingUpdates->push_back(std_::move(update));
+		}
+
+		if (SmallUpdates->isEmpty()) {
+			std::swap(smallList, *SmallUpdates);
+			SmallUpdates->resize(0);
+		}
+	}
 
-	auto smallList = base::take(*SmallUpdates);
-	auto allList = base::take(*AllUpdates);
-	for (auto &update : smallList) {
-		PeerUpdated().notify(std_::move(update), true);
+	++Stats.slices;
+	auto sending = base::take(*SendingUpdates);
+	auto ms = getms(true), till = ms + kSendDelayedBudgetMs;
+	auto i = 0, count = sending.size();
+	for (; i != count; ++i) {
+		if (i > 0 && getms(true) >= till) {
+			break;
+		}
+		++Stats.updates;
+		if (auto peerObservable = PeerUpdatedObservables.value(sending[i].peer)) {
+			peerObservable->notify(sending[i], true);
+		}
+		AllPeersUpdatedObservable.notify(std_::move(sending[i]), true);
 	}
-	for (auto &update : allList) {
-		PeerUpdated().notify(std_::move(update), true);
+	if (i != count) {
+		DEBUG_LOG(("Peer Updates: sent %1 of %2 updates in %3ms, continuing").arg(i).arg(count).arg(getms(true) - ms));
+		sending.erase(sending.begin(), sending.begin() + i);
+		*SendingUpdates = std_::move(sending);
+		Global::RefHandleDelayedPeerUpdates().call();
 	}
+}
 
-	if (SmallUpdates->isEmpty()) {
-		std::swap(smallList, *SmallUpdates);
-		SmallUpdates->resize(0);
+const PeerUpdateStats &peerUpdateStats() {
+	return Stats;
+}
+
+QString peerUpdateStatsReport() {
+	QStringList result;
+	result.push_back(qsl("Peer updates: %1 sent in %2 slices, handlers called %3 times, skipped %4 times").arg(Stats.updates).arg(Stats.slices).arg(Stats.calls).arg(Stats.skipped));
+	HandlersStats.createIfNull();
+	for_const (auto stats, *HandlersStats) {
+		auto peer = stats->peer ? QString::number(stats->peer->id) : qsl("all");
+		result.push_back(qsl("Handler for peer %1, events %2: called %3 times, skipped %4 times").arg(peer).arg(int(stats->events), 0, 16).arg(stats->calls).arg(stats->skipped));
+	}
+	return result.join('\n');
+}
+
+namespace internal {
+
+void registerPeerUpdateHandler(PeerUpdateHandlerStats *stats) {
+	HandlersStats.createIfNull();
+	HandlersStats->insert(stats);
+}
+
+void unregisterPeerUpdateHandler(PeerUpdateHandlerStats *stats) {
+	if (HandlersStats) {
+		HandlersStats->remove(stats);
 	}
 }
 
+void peerUpdateHandled(PeerUpdateHandlerStats *stats, bool called) {
+	if (called) {
+		++stats->calls;
+		++Stats.calls;
+	} else {
+		++stats->skipped;
+		++Stats.skipped;
+	}
+}
+
+} // namespace internal
+
 base::Observable<PeerUpdate, PeerUpdatedHandler> &PeerUpdated() {
-	return PeerUpdatedObservable;
+	return AllPeersUpdatedObservable;
+}
+
+base::Observable<PeerUpdate, PeerUpdatedHandler> &PeerUpdated(PeerData *peer) {
+	auto i = PeerUpdatedObservables.constFind(peer);
+	if (i == PeerUpdatedObservables.cend()) {
+		i = PeerUpdatedObservables.insert(peer, new PeerUpdatedObservable());
+	}
+	return *i.value();
 }
 
 } // namespace Notify
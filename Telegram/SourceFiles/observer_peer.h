@@ -87,24 +87,78 @@ inline void peerUpdatedDelayed(PeerData *peer, PeerUpdate::Flags events) {
 	update.flags = events;
 	peerUpdatedDelayed(update);
 }
+
+// Sends the delayed updates for some milliseconds and schedules
+// itself to the next event loop iteration if not all were sent.
 void peerUpdatedSendDelayed();
 
+struct PeerUpdateStats {
+	int64 updates = 0; // updates sent to the observers
+	int64 calls = 0; // handlers called
+	int64 skipped = 0; // handlers not called because of flags
+	int64 slices = 0; // event loop iterations used to send the updates
+};
+const PeerUpdateStats &peerUpdateStats();
+
+// Counters of one subscribed handler, they live while the subscription does.
+struct PeerUpdateHandlerStats {
+	PeerUpdateHandlerStats(PeerData *peer, PeerUpdate::Flags events) : peer(peer), events(events) {
+	}
+	PeerData *peer; // nullptr for the handlers of all peers updates
+	PeerUpdate::Flags events;
+	int64 calls = 0;
+	int64 skipped = 0;
+};
+QString peerUpdateStatsReport(); // totals and the counters of each subscribed handler
+
+namespace internal {
+void registerPeerUpdateHandler(PeerUpdateHandlerStats *stats);
+void unregisterPeerUpdateHandler(PeerUpdateHandlerStats *stats);
+void peerUpdateHandled(PeerUpdateHandlerStats *stats, bool called);
+} // namespace internal
+
 class PeerUpdatedHandler {
 public:
 	template <typename Lambda>
-	PeerUpdatedHandler(PeerUpdate::Flags events, Lambda &&handler) : _events(events), _handler(std_::move(handler)) {
+	PeerUpdatedHandler(PeerUpdate::Flags events, Lambda &&handler) : PeerUpdatedHandler(nullptr, events, std_::move(handler)) {
+	}
+
+	// For the subscriptions to PeerUpdated(peer), the peer is used only in the stats.
+	template <typename Lambda>
+	PeerUpdatedHandler(PeerData *peer, PeerUpdate::Flags events, Lambda &&handler) : _events(events)
+	, _handler(std_::move(handler))
+	, _stats(std_::make_unique<PeerUpdateHandlerStats>(peer, events)) {
+		internal::registerPeerUpdateHandler(_stats.get());
 	}
+	PeerUpdatedHandler(PeerUpdatedHandler &&other) = default;
+	PeerUpdatedHandler &operator=(PeerUpdatedHandler &&other) = delete;
+
 	void operator()(const PeerUpdate &update) const {
-		if (update.flags & _events) {
+		auto call = (update.flags & _events) != 0;
+		internal::peerUpdateHandled(_stats.get(), call);
+		if (call) {
 			_handler(update);
 		}
 	}
 
+	~PeerUpdatedHandler() {
+		if (_stats) {
+			internal::unregisterPeerUpdateHandler(_stats.get());
+		}
+	}
+
 private:
 	PeerUpdate::Flags _events;
 	base::lambda_unique<void(const PeerUpdate&)> _handler;
+	std_::unique_ptr<PeerUpdateHandlerStats> _stats;
 
 };
+
+// Updates of all peers.
 base::Observable<PeerUpdate, PeerUpdatedHandler> &PeerUpdated();
 
+// Updates of one peer only, so that sending an update doesn't
+// visit the subscribers of all the other opened peer profiles.
+base::Observable<PeerUpdate, PeerUpdatedHandler> &PeerUpdated(PeerData *peer);
+
 } // namespace Notify
@@ -153,15 +153,29 @@ int32 OverviewInner::migratedIndexSkip() const {
 	return (_migrated && _history->overviewLoaded(_type)) ? _migrated->overview[_type].size() : 0;
 }
 
+HistoryItem *OverviewInner::itemAt(int32 index) const {
+	if (_type == OverviewPhotos || _type == OverviewVideos) {
+		return _gridItems.at(index);
+	}
+	return _items.at(index)->getItem();
+}
+
+int32 OverviewInner::itemsCount() const {
+	if (_type == OverviewPhotos || _type == OverviewVideos) {
+		return _gridItems.size();
+	}
+	return _items.size();
+}
+
 void OverviewInner::fixItemIndex(int32 &current, MsgId msgId) const {
 	if (!msgId) {
 		current = -1;
 	} else {
-		int32 l = _items.size();
-		if (current < 0 || current >= l || complexMsgId(_items.at(current)->getItem()) != msgId) {
+		int32 l = itemsCount();
+		if (current < 0 || current >= l || complexMsgId(itemAt(current)) != msgId) {
 			current = -1;
 			for (int32 i = 0; i < l; ++i) {
-				if (complexMsgId(_items.at(i)->getItem()) == msgId) {
+				if (complexMsgId(itemAt(i)) == msgId) {
 					current = i;
 					break;
 				}
@@ -300,14 +314,14 @@ void OverviewInner::moveToNextItem(MsgId &msgId, int32 &index, MsgId upTo, int32
 	}
 
 	index += delta;
-	while (index >= 0 && index < _items.size() && !_items.at(index)->toMediaItem()) {
+	while (index >= 0 && index < itemsCount() && !itemAt(index)) { // skip day items
 		index += (delta > 0) ? 1 : -1;
 	}
-	if (index < 0 || index >= _items.size()) {
+	if (index < 0 || index >= itemsCount()) {
 		msgId = 0;
 		index = -1;
 	} else {
-		msgId = complexMsgId(_items.at(index)->getItem());
+		msgId = complexMsgId(itemAt(index));
 	}
 }
 
@@ -627,7 +641,7 @@ void OverviewInner::touchScrollUpdated(const QPoint &screenPos) {
 void OverviewInner::addSelectionRange(int32 selFrom, int32 selTo, History *history) {
 	if (selFrom < 0 || selTo < 0) return;
 	for (int32 i = selFrom; i <= selTo; ++i) {
-		MsgId msgid = complexMsgId(_items.at(i)->getItem());
+		MsgId msgid = complexMsgId(itemAt(i));
 		if (!msgid) continue;
 
 		SelectedItems::iterator j = _selected.find(msgid);
@@ -698,6 +712,7 @@ void OverviewInner::clear() {
 	}
 	_layoutDates.clear();
 	_items.clear();
+	_gridItems.clear();
 
 	App::clearMousedItems();
 }
@@ -752,11 +767,11 @@ TextSelection OverviewInner::itemSelectedValue(int32 index) const {
 		selfrom = _dragSelToIndex;
 		selto = _dragSelFromIndex;
 	}
-	if (_items.at(index)->toMediaItem()) { // draw item
+	if (auto item = itemAt(index)) { // draw item
 		if (index >= _dragSelToIndex && index <= _dragSelFromIndex && _dragSelToIndex >= 0) {
-			return (_dragSelecting && _items.at(index)->msgId() > 0) ? FullSelection : TextSelection{ 0, 0 };
+			return (_dragSelecting && item->id > 0) ? FullSelection : TextSelection{ 0, 0 };
 		} else if (!_selected.isEmpty()) {
-			SelectedItems::const_iterator j = _selected.constFind(complexMsgId(_items.at(index)->getItem()));
+			SelectedItems::const_iterator j = _selected.constFind(complexMsgId(item));
 			if (j != _selected.cend()) {
 				return j.value();
 			}
@@ -798,7 +813,7 @@ void OverviewInner::paintEvent(QPaintEvent *e) {
 	bool hasSel = !_selected.isEmpty();
 
 	if (_type == OverviewPhotos || _type == OverviewVideos) {
-		int32 count = _items.size(), rowsCount = count / _photosInRow + ((count % _photosInRow) ? 1 : 0);
+		int32 count = _gridItems.size(), rowsCount = count / _photosInRow + ((count % _photosInRow) ? 1 : 0);
 		int32 rowFrom = floorclamp(r.y() - _marginTop - st::overviewPhotoSkip, _rowWidth + st::overviewPhotoSkip, 0, rowsCount);
 		int32 rowTo = ceilclamp(r.y() + r.height() - _marginTop - st::overviewPhotoSkip, _rowWidth + st::overviewPhotoSkip, 0, rowsCount);
 		float64 w = float64(_width - st::overviewPhotoSkip) / _photosInRow;
@@ -810,9 +825,11 @@ void OverviewInner::paintEvent(QPaintEvent *e) {
 				if (i >= count) break;
 
 				QPoint pos(int32(col * w + st::overviewPhotoSkip), _marginTop + row * (_rowWidth + st::overviewPhotoSkip) + st::overviewPhotoSkip);
-				p.translate(pos.x(), pos.y());
-				_items.at(i)->paint(p, r.translated(-pos.x(), -pos.y()), itemSelectedValue(i), &context);
-				p.translate(-pos.x(), -pos.y());
+				if (auto layout = gridLayoutAt(i)) {
+					p.translate(pos.x(), pos.y());
+					layout->paint(p, r.translated(-pos.x(), -pos.y()), itemSelectedValue(i), &context);
+					p.translate(-pos.x(), -pos.y());
+				}
 			}
 		}
 	} else {
@@ -864,7 +881,7 @@ void OverviewInner::onUpdateSelected() {
 		if (row < 0) row = 0;
 		bool upon = true;
 
-		int32 count = _items.size(), i = row * _photosInRow + col;
+		int32 count = _gridItems.size(), i = row * _photosInRow + col;
 		if (i < 0) {
 			i = 0;
 			upon = false;
@@ -874,7 +891,7 @@ void OverviewInner::onUpdateSelected() {
 			upon = false;
 		}
 		if (i >= 0) {
-			if (auto media = _items.at(i)->toMediaItem()) {
+			if (auto media = gridLayoutAt(i)) {
 				item = media->getItem();
 				index = i;
 				if (upon) {
@@ -1281,8 +1298,8 @@ int32 OverviewInner::resizeToWidth(int32 nwidth, int32 scrollTop, int32 minHeigh
 	_cancelSearch.moveToLeft(_rowsLeft + _rowWidth - _cancelSearch.width(), _search.y());
 
 	if (_type == OverviewPhotos || _type == OverviewVideos) {
-		for (int32 i = 0, l = _items.size(); i < l; ++i) {
-			_items.at(i)->resizeGetHeight(_rowWidth);
+		for_const (auto layout, _layoutItems) {
+			layout->resizeGetHeight(_rowWidth);
 		}
 		_height = countHeight();
 	} else {
@@ -1578,9 +1595,9 @@ void OverviewInner::mediaOverviewUpdated() {
 	if (_type == OverviewPhotos || _type == OverviewVideos) {
 		History::MediaOverview &o(_history->overview[_type]), *migratedOverview = _migrated ? &_migrated->overview[_type] : 0;
 		int32 migrateCount = migratedIndexSkip();
-		int32 wasCount = _items.size(), fullCount = (migrateCount + o.size());
+		int32 fullCount = (migrateCount + o.size());
 		int32 tocheck = qMin(fullCount, _itemsToBeLoaded);
-		_items.reserve(tocheck);
+		_gridItems.reserve(tocheck);
 
 		int32 index = 0;
 		bool allGood = true;
@@ -1588,22 +1605,28 @@ void OverviewInner::mediaOverviewUpdated() {
 			--i;
 			MsgId msgid = ((i < migrateCount) ? -migratedOverview->at(i) : o.at(i - migrateCount));
 			if (allGood) {
-				if (_items.size() > index && complexMsgId(_items.at(index)->getItem()) == msgid) {
+				if (_gridItems.size() > index && complexMsgId(_gridItems.at(index)) == msgid) {
 					++index;
 					continue;
 				}
 				allGood = false;
 			}
 			HistoryItem *item = App::histItemById(itemChannel(msgid), itemMsgId(msgid));
-			auto layout = layoutPrepare(item);
-			if (!layout) continue;
+			if (!isGridItem(item)) continue;
 
-			setLayoutItem(index, layout, 0);
+			if (_gridItems.size() > index) {
+				_gridItems[index] = item;
+			} else {
+				_gridItems.push_back(item);
+			}
 			++index;
 		}
-		if (_items.size() > index) _items.resize(index);
+		if (_gridItems.size() > index) _gridItems.resize(index);
 
 		_height = countHeight();
+
+		// Drop layouts of the items that were removed from the overview.
+		visibleAreaUpdated(_visibleTop, _visibleBottom);
 	} else {
 		bool dateEveryMonth = (_type == OverviewFiles), dateEveryDay = (_type == OverviewLinks);
 		bool withDates = (dateEveryMonth || dateEveryDay);
@@ -1725,6 +1748,10 @@ void OverviewInner::itemRemoved(HistoryItem *item) {
 		delete j.value();
 		_layoutItems.erase(j);
 	}
+	int32 gridIndex = _gridItems.indexOf(item);
+	if (gridIndex >= 0) {
+		_gridItems.remove(gridIndex);
+	}
 
 	if (_dragSelFrom == msgId || _dragSelTo == msgId) {
 		_dragSelFrom = 0;
@@ -1748,8 +1775,8 @@ void OverviewInner::repaintItem(const HistoryItem *msg) {
 	if (history->overviewHasMsgId(_type, msgid) && (history == _history || migrateindex > 0)) {
 		if (_type == OverviewPhotos || _type == OverviewVideos) {
 			if (history == _migrated) msgid = -msgid;
-			for (int32 i = 0, l = _items.size(); i != l; ++i) {
-				if (complexMsgId(_items.at(i)->getItem()) == msgid) {
+			for (int32 i = 0, l = _gridItems.size(); i != l; ++i) {
+				if (complexMsgId(_gridItems.at(i)) == msgid) {
 					float64 w = (float64(width() - st::overviewPhotoSkip) / _photosInRow);
 					int32 vsize = (_rowWidth + st::overviewPhotoSkip);
 					int32 row = i / _photosInRow, col = i % _photosInRow;
@@ -1774,7 +1801,7 @@ void OverviewInner::repaintItem(const HistoryItem *msg) {
 int32 OverviewInner::countHeight() {
 	int32 result = _height;
 	if (_type == OverviewPhotos || _type == OverviewVideos) {
-		int32 count = _items.size();
+		int32 count = _gridItems.size();
 		int32 migratedFullCount = _migrated ? _migrated->overviewCount(_type) : 0;
 		int32 fullCount = migratedFullCount + _history->overviewCount(_type);
 		int32 rows = (count / _photosInRow) + ((count % _photosInRow) ? 1 : 0);
@@ -1841,6 +1868,68 @@ Overview::Layout::ItemBase *OverviewInner::layoutPrepare(HistoryItem *item) {
 	return (i == _layoutItems.cend()) ? nullptr : i.value();
 }
 
+bool OverviewInner::isGridItem(HistoryItem *item) const {
+	auto media = item ? item->getMedia() : nullptr;
+	if (!media) return false;
+
+	return (media->type() == ((_type == OverviewPhotos) ? MediaTypePhoto : MediaTypeVideo));
+}
+
+Overview::Layout::ItemBase *OverviewInner::gridLayoutAt(int32 index) {
+	auto item = _gridItems.at(index);
+	auto i = _layoutItems.constFind(item);
+	if (i != _layoutItems.cend()) {
+		return i.value();
+	}
+	auto result = layoutPrepare(item);
+	if (result) {
+		result->resizeGetHeight(_rowWidth);
+	}
+	return result;
+}
+
+void OverviewInner::visibleAreaUpdated(int visibleTop, int visibleBottom) {
+	_visibleTop = visibleTop;
+	_visibleBottom = visibleBottom;
+	if (_type != OverviewPhotos && _type != OverviewVideos) return;
+	if (_layoutItems.isEmpty() || _photosInRow <= 0 || visibleBottom <= visibleTop) return;
+
+	// Keep layouts for one screen above and one screen below the visible area.
+	int32 vsize = (_rowWidth + st::overviewPhotoSkip), screen = (visibleBottom - visibleTop);
+	int32 count = _gridItems.size(), rowsCount = count / _photosInRow + ((count % _photosInRow) ? 1 : 0);
+	int32 rowFrom = floorclamp(visibleTop - screen - _marginTop, vsize, 0, rowsCount);
+	int32 rowTill = ceilclamp(visibleBottom + screen - _marginTop, vsize, 0, rowsCount);
+	int32 from = rowFrom * _photosInRow, till = qMin(rowTill * _photosInRow, count);
+	OrderedSet<HistoryItem*> keep;
+	for (int32 i = from; i < till; ++i) {
+		keep.insert(_gridItems.at(i));
+	}
+	for (auto i = _layoutItems.begin(); i != _layoutItems.end();) {
+		if (keep.contains(i.key())) {
+			++i;
+		} else {
+			delete i.value();
+			i = _layoutItems.erase(i);
+		}
+	}
+}
+
+void OverviewInner::prefetchMedia(int visibleTop, int visibleBottom) {
+	if (_type != OverviewPhotos && _type != OverviewVideos) return;
+	if (_photosInRow <= 0 || visibleBottom <= visibleTop) return;
+
+	_mediaPrefetcher.visibleAreaUpdated(visibleTop, visibleBottom);
+
+	int32 vsize = (_rowWidth + st::overviewPhotoSkip);
+	int32 count = _gridItems.size(), rowsCount = count / _photosInRow + ((count % _photosInRow) ? 1 : 0);
+	int32 rowFrom = floorclamp(_mediaPrefetcher.prefetchTop() - _marginTop, vsize, 0, rowsCount);
+	int32 rowTill = ceilclamp(_mediaPrefetcher.prefetchBottom() - _marginTop, vsize, 0, rowsCount);
+	for (int32 i = rowFrom * _photosInRow, till = qMin(rowTill * _photosInRow, count); i < till; ++i) {
+		_mediaPrefetcher.add(_gridItems.at(i));
+	}
+	_mediaPrefetcher.finish();
+}
+
 Overview::Layout::AbstractItem *OverviewInner::layoutPrepare(const QDate &date, bool month) {
 	int32 key = date.year() * 100 + date.month();
 	if (!month) key = key * 100 + date.day();
@@ -1910,6 +1999,8 @@ void OverviewWidget::onScroll() {
 	if (!_noDropResizeIndex) {
 		_inner.dropResizeIndex();
 	}
+	_inner.visibleAreaUpdated(_scroll.scrollTop(), _scroll.scrollTop() + _scroll.height());
+	_inner.prefetchMedia(_scroll.scrollTop(), _scroll.scrollTop() + _scroll.height());
 }
 
 void OverviewWidget::resizeEvent(QResizeEvent *e) {
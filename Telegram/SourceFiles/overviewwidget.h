@@ -22,6 +22,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 
 #include "window/section_widget.h"
 #include "ui/popupmenu.h"
+#include "data/data_media_prefetch.h"
 
 namespace Overview {
 namespace Layout {
@@ -63,6 +64,10 @@ public:
 	int32 resizeToWidth(int32 nwidth, int32 scrollTop, int32 minHeight, bool force = false); // returns new scroll top
 	void dropResizeIndex();
 
+	// Photos and videos grid creates layouts only near the visible area.
+	void visibleAreaUpdated(int visibleTop, int visibleBottom);
+	void prefetchMedia(int visibleTop, int visibleBottom);
+
 	PeerData *peer() const;
 	PeerData *migratePeer() const;
 	MediaOverviewType type() const;
@@ -131,6 +136,8 @@ private:
 	MsgId itemMsgId(MsgId msgId) const;
 	int32 migratedIndexSkip() const;
 
+	HistoryItem *itemAt(int32 index) const;
+	int32 itemsCount() const;
 	void fixItemIndex(int32 &current, MsgId msgId) const;
 	bool itemHasPoint(MsgId msgId, int32 index, int32 x, int32 y) const;
 	int32 itemHeight(MsgId msgId, int32 index) const;
@@ -169,6 +176,17 @@ private:
 
 	typedef QVector<Overview::Layout::AbstractItem*> Items;
 	Items _items;
+
+	// In photos and videos grid all items have the same size, so instead of
+	// _items we keep just the history items and create layouts on demand.
+	typedef QVector<HistoryItem*> GridItems;
+	GridItems _gridItems;
+	bool isGridItem(HistoryItem *item) const;
+	Overview::Layout::ItemBase *gridLayoutAt(int32 index);
+	int _visibleTop = 0;
+	int _visibleBottom = 0;
+	Data::MediaPrefetcher _mediaPrefetcher = { Data::MediaPrefetcher::PhotoSize::Medium };
+
 	typedef QMap<HistoryItem*, Overview::Layout::ItemBase*> LayoutItems;
 	LayoutItems _layoutItems;
 	typedef QMap<int32, Overview::Layout::Date*> LayoutDates;
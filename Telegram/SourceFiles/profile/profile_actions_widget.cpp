@@ -39,7 +39,7 @@ ActionsWidget::ActionsWidget(QWidget *parent, PeerData *peer) : BlockWidget(pare
 		| UpdateFlag::UserIsBlocked
 		| UpdateFlag::BotCommandsChanged
 		| UpdateFlag::MembersChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 
@@ -48,10 +48,6 @@ ActionsWidget::ActionsWidget(QWidget *parent, PeerData *peer) : BlockWidget(pare
 }
 
 void ActionsWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != peer()) {
-		return;
-	}
-
 	auto needFullRefresh = [&update, this]() {
 		if (update.flags & UpdateFlag::BotCommandsChanged) {
 			if (_hasBotHelp != hasBotCommand(qsl("help")) || _hasBotSettings != hasBotCommand(qsl("settings"))) {
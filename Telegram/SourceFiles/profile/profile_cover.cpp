@@ -69,7 +69,7 @@ CoverWidget::CoverWidget(QWidget *parent, PeerData *peer) : TWidget(parent)
 		| UpdateFlag::NameChanged
 		| UpdateFlag::UserOnlineChanged
 		| UpdateFlag::MembersChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 	subscribe(FileDialog::QueryDone(), [this](const FileDialog::QueryUpdate &update) {
@@ -328,9 +328,6 @@ void CoverWidget::paintDivider(Painter &p) {
 }
 
 void CoverWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != _peer) {
-		return;
-	}
 	if ((update.flags & ButtonsUpdateFlags) != 0) {
 		refreshButtons();
 	}
@@ -83,7 +83,7 @@ FixedBar::FixedBar(QWidget *parent, PeerData *peer) : TWidget(parent)
 
 	auto observeEvents = ButtonsUpdateFlags
 		| UpdateFlag::MigrationChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdate(update);
 	}));
 
@@ -91,9 +91,6 @@ FixedBar::FixedBar(QWidget *parent, PeerData *peer) : TWidget(parent)
 }
 
 void FixedBar::notifyPeerUpdate(const Notify::PeerUpdate &update) {
-	if (update.peer != _peer) {
-		return;
-	}
 	if ((update.flags & ButtonsUpdateFlags) != 0) {
 		refreshRightActions();
 	}
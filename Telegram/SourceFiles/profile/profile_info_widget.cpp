@@ -36,7 +36,7 @@ InfoWidget::InfoWidget(QWidget *parent, PeerData *peer) : BlockWidget(parent, pe
 		| UpdateFlag::UsernameChanged
 		| UpdateFlag::UserPhoneChanged
 		| UpdateFlag::UserCanShareContact;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 
@@ -44,10 +44,6 @@ InfoWidget::InfoWidget(QWidget *parent, PeerData *peer) : BlockWidget(parent, pe
 }
 
 void InfoWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != peer()) {
-		return;
-	}
-
 	if (update.flags & UpdateFlag::AboutChanged) {
 		refreshAbout();
 	}
@@ -33,7 +33,7 @@ using UpdateFlag = Notify::PeerUpdate::Flag;
 
 InviteLinkWidget::InviteLinkWidget(QWidget *parent, PeerData *peer) : BlockWidget(parent, peer, lang(lng_profile_invite_link_section)) {
 	auto observeEvents = UpdateFlag::InviteLinkChanged | UpdateFlag::UsernameChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 
@@ -42,10 +42,6 @@ InviteLinkWidget::InviteLinkWidget(QWidget *parent, PeerData *peer) : BlockWidge
 }
 
 void InviteLinkWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != peer()) {
-		return;
-	}
-
 	if (update.flags & (UpdateFlag::InviteLinkChanged | UpdateFlag::UsernameChanged)) {
 		refreshLink();
 		refreshVisibility();
@@ -604,7 +604,7 @@ ChannelMembersWidget::ChannelMembersWidget(QWidget *parent, PeerData *peer) : Bl
 		| UpdateFlag::ChannelCanViewMembers
 		| UpdateFlag::AdminsChanged
 		| UpdateFlag::MembersChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 
@@ -612,10 +612,6 @@ ChannelMembersWidget::ChannelMembersWidget(QWidget *parent, PeerData *peer) : Bl
 }
 
 void ChannelMembersWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != peer()) {
-		return;
-	}
-
 	if (update.flags & (UpdateFlag::ChannelCanViewAdmins | UpdateFlag::AdminsChanged)) {
 		refreshAdmins();
 	}
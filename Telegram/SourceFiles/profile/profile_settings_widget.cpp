@@ -51,7 +51,7 @@ SettingsWidget::SettingsWidget(QWidget *parent, PeerData *peer) : BlockWidget(pa
 			observeEvents |= UpdateFlag::UsernameChanged | UpdateFlag::InviteLinkChanged;
 		}
 	}
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 
@@ -62,10 +62,6 @@ SettingsWidget::SettingsWidget(QWidget *parent, PeerData *peer) : BlockWidget(pa
 }
 
 void SettingsWidget::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != peer()) {
-		return;
-	}
-
 	if (update.flags & UpdateFlag::NotificationsEnabled) {
 		refreshEnableNotifications();
 	}
@@ -37,7 +37,7 @@ UserpicButton::UserpicButton(QWidget *parent, PeerData *peer) : Button(parent),
 	}
 
 	auto observeEvents = Notify::PeerUpdate::Flag::PhotoChanged;
-	subscribe(Notify::PeerUpdated(), Notify::PeerUpdatedHandler(observeEvents, [this](const Notify::PeerUpdate &update) {
+	subscribe(Notify::PeerUpdated(peer), Notify::PeerUpdatedHandler(peer, observeEvents, [this](const Notify::PeerUpdate &update) {
 		notifyPeerUpdated(update);
 	}));
 	subscribe(FileDownload::ImageLoaded(), [this] {
@@ -68,10 +68,6 @@ void UserpicButton::paintEvent(QPaintEvent *e) {
 }
 
 void UserpicButton::notifyPeerUpdated(const Notify::PeerUpdate &update) {
-	if (update.peer != _peer) {
-		return;
-	}
-
 	processNewPeerPhoto();
 	this->update();
 }
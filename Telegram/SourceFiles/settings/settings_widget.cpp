@@ -31,6 +31,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "localstorage.h"
 #include "boxes/confirmbox.h"
 #include "application.h"
+#include "observer_peer.h"
 
 namespace Settings {
 namespace {
@@ -63,6 +64,26 @@ void fillCodes() {
 		}
 		Ui::showLayer(new InformBox(DebugLogging::FileLoader() ? qsl("Enabled file download logging") : qsl("Disabled file download logging")));
 	});
+	Codes.insert(qsl("debugmemory"), []() {
+		if (!cDebug()) return;
+		if (DebugLogging::Memory()) {
+			Global::RefDebugLoggingFlags() &= ~DebugLogging::MemoryFlag;
+		} else {
+			Global::RefDebugLoggingFlags() |= DebugLogging::MemoryFlag;
+		}
+		App::app()->onMemoryReport();
+		Ui::showLayer(new InformBox(DebugLogging::Memory() ? qsl("Enabled periodic memory usage logging") : qsl("Disabled periodic memory usage logging")));
+	});
+	Codes.insert(qsl("memorystats"), []() {
+		auto report = App::memoryReport();
+		LOG(("Memory Info:\n%1").arg(report));
+		Ui::showLayer(new InformBox(report));
+	});
+	Codes.insert(qsl("peerupdates"), []() {
+		auto report = Notify::peerUpdateStatsReport();
+		LOG(("Peer Updates Info:\n%1").arg(report));
+		Ui::showLayer(new InformBox(report));
+	});
 	Codes.insert(qsl("crashplease"), []() {
 		t_assert(!"Crashed in Settings!");
 	});
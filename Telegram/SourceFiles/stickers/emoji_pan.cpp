@@ -37,6 +37,13 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "mainwidget.h"
 
 namespace internal {
+namespace {
+
+bool stickerHasGoodThumb(DocumentData *sticker) {
+	return !sticker->thumb->isNull() && ((sticker->thumb->width() >= 128) || (sticker->thumb->height() >= 128));
+}
+
+} // namespace
 
 EmojiColorPicker::EmojiColorPicker() : TWidget()
 , _a_selected(animation(this, &EmojiColorPicker::step_selected))
@@ -834,6 +841,72 @@ void StickerPanInner::setVisibleTopBottom(int visibleTop, int visibleBottom) {
 	if (_section == Section::Featured) {
 		readVisibleSets();
 	}
+	prefetchStickers();
+}
+
+void StickerPanInner::prefetchStickers() {
+	_stickersPrefetcher.visibleAreaUpdated(_visibleTop, _visibleBottom);
+	if (!showingInlineItems()) {
+		auto from = _stickersPrefetcher.prefetchTop(), till = _stickersPrefetcher.prefetchBottom();
+
+		// Visible stickers are loaded by paintSticker(), the rest of the rows
+		// are queued starting from the ones closest to the visible area.
+		struct Row {
+			int distance;
+			int set;
+			int index; // index of the first sticker in the row
+		};
+		QVector<Row> rows;
+		auto addRow = [this, &rows, from, till](int top, int set, int index) {
+			auto bottom = top + st::stickerPanSize.height();
+			if (bottom <= from || top >= till) {
+				return;
+			}
+			if (bottom <= _visibleTop) {
+				rows.push_back({ _visibleTop - bottom, set, index });
+			} else if (top >= _visibleBottom) {
+				rows.push_back({ top - _visibleBottom, set, index });
+			}
+		};
+
+		auto &sets = shownSets();
+		if (_section == Section::Featured) {
+			for (int i = 0, count = sets.size(); i != count; ++i) {
+				auto top = st::emojiPanHeader + i * featuredRowHeight() + st::featuredStickersHeader;
+				if (top >= till) break;
+
+				addRow(top, i, 0);
+			}
+		} else {
+			auto top = 0;
+			for (int i = 0, count = sets.size(); i != count; ++i) {
+				auto size = sets[i].pack.size();
+				auto rowsCount = (size / StickerPanPerRow) + ((size % StickerPanPerRow) ? 1 : 0);
+				auto rowsTop = top + st::emojiPanHeader;
+				top = rowsTop + rowsCount * st::stickerPanSize.height();
+				if (top <= from) continue;
+				if (rowsTop >= till) break;
+
+				for (int row = 0; row != rowsCount; ++row) {
+					addRow(rowsTop + row * st::stickerPanSize.height(), i, row * StickerPanPerRow);
+				}
+			}
+		}
+		std::stable_sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+			return a.distance < b.distance;
+		});
+
+		for_const (auto &row, rows) {
+			auto &pack = sets[row.set].pack;
+			for (int i = row.index, end = qMin(row.index + int(StickerPanPerRow), pack.size()); i != end; ++i) {
+				auto sticker = pack[i];
+				if (stickerHasGoodThumb(sticker)) {
+					_stickersPrefetcher.add(sticker);
+				}
+			}
+		}
+	}
+	_stickersPrefetcher.finish();
 }
 
 void StickerPanInner::readVisibleSets() {
@@ -1114,11 +1187,11 @@ void StickerPanInner::paintSticker(Painter &p, Set &set, int y, int index) {
 		p.setOpacity(1);
 	}
 
-	bool goodThumb = !sticker->thumb->isNull() && ((sticker->thumb->width() >= 128) || (sticker->thumb->height() >= 128));
+	bool goodThumb = stickerHasGoodThumb(sticker);
 	if (goodThumb) {
 		sticker->thumb->load();
 	} else {
-		sticker->checkSticker();
+		sticker->automaticLoad(nullptr); // the image is decoded in stickerPix() only if needed
 	}
 
 	float64 coef = qMin((st::stickerPanSize.width() - st::buttonRadius * 2) / float64(sticker->dimensions.width()), (st::stickerPanSize.height() - st::buttonRadius * 2) / float64(sticker->dimensions.height()));
@@ -1129,8 +1202,11 @@ void StickerPanInner::paintSticker(Painter &p, Set &set, int y, int index) {
 	QPoint ppos = pos + QPoint((st::stickerPanSize.width() - w) / 2, (st::stickerPanSize.height() - h) / 2);
 	if (goodThumb) {
 		p.drawPixmapLeft(ppos, width(), sticker->thumb->pix(w, h));
-	} else if (!sticker->sticker()->img->isNull()) {
-		p.drawPixmapLeft(ppos, width(), sticker->sticker()->img->pix(w, h));
+	} else {
+		auto pixmap = sticker->stickerPix(w, h);
+		if (!pixmap.isNull()) {
+			p.drawPixmapLeft(ppos, width(), pixmap);
+		}
 	}
 
 	if (hover > 0 && set.id == Stickers::RecentSetId && _custom.at(index)) {
@@ -22,6 +22,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 
 #include "ui/twidget.h"
 #include "ui/effects/rect_shadow.h"
+#include "data/data_media_prefetch.h"
 
 namespace InlineBots {
 namespace Layout {
@@ -318,6 +319,7 @@ private:
 	}
 	int featuredRowHeight() const;
 	void readVisibleSets();
+	void prefetchStickers();
 
 	bool showingInlineItems() const { // Gifs or Inline results
 		return (_section == Section::Inlines) || (_section == Section::Gifs);
@@ -367,6 +369,8 @@ private:
 	QString _inlineBotTitle;
 	uint64 _lastScrolled = 0;
 	QTimer _updateInlineItems;
+
+	Data::MediaPrefetcher _stickersPrefetcher = { Data::MediaPrefetcher::PhotoSize::Medium };
 	bool _inlineWithThumb = false;
 
 	std_::unique_ptr<BoxButton> _switchPmButton;
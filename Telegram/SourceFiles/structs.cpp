@@ -22,6 +22,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "structs.h"
 
 #include "lang.h"
+#include "data/data_userpics.h"
 #include "inline_bots/inline_bot_layout_item.h"
 #include "observer_peer.h"
 #include "mainwidget.h"
@@ -38,6 +39,16 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 
 namespace {
 
+bool hasRussianLetters(const QString &text) {
+	for_const (auto ch, text) {
+		auto code = ch.unicode();
+		if ((code >= 0x0410 && code <= 0x044F) || code == 0x0401 || code == 0x0451) { // [а-яА-ЯёЁ]
+			return true;
+		}
+	}
+	return false;
+}
+
 int peerColorIndex(const PeerId &peer) {
 	auto myId = MTP::authedId();
 	auto peerId = peerToBareInt(peer);
@@ -192,7 +203,12 @@ ImagePtr PeerData::currentUserpic() const {
 }
 
 void PeerData::paintUserpic(Painter &p, int size, int x, int y) const {
-	p.drawPixmap(x, y, currentUserpic()->pixCircled(size, size));
+	if (!photoLoc.isNull() && _userpic->loaded()) {
+		p.drawPixmap(x, y, Data::circledUserpic(_userpic, storageKey(photoLoc), size));
+	} else {
+		// Default userpics are shared by all peers of the same color.
+		p.drawPixmap(x, y, currentUserpic()->pixCircled(size, size));
+	}
 }
 
 StorageKey PeerData::userpicUniqueKey() const {
@@ -260,7 +276,7 @@ void PeerData::fillNames() {
 	names.clear();
 	chars.clear();
 	QString toIndex = textAccentFold(name);
-	if (cRussianLetters().match(toIndex).hasMatch()) {
+	if (hasRussianLetters(toIndex)) {
 		toIndex += ' ' + translitRusEng(toIndex);
 	}
 	if (isUser()) {
@@ -271,7 +287,7 @@ void PeerData::fillNames() {
 	}
 	toIndex += ' ' + rusKeyboardLayoutSwitch(toIndex);
 
-	QStringList namesList = toIndex.toLower().split(cWordSplit(), QString::SkipEmptyParts);
+	QStringList namesList = textSplitWords(toIndex.toLower());
 	for (QStringList::const_iterator i = namesList.cbegin(), e = namesList.cend(); i != e; ++i) {
 		names.insert(*i);
 		chars.insert(i->at(0));
@@ -768,6 +784,13 @@ void PhotoData::forget() {
 	full->forget();
 }
 
+void PhotoData::unload() {
+	thumb->unload();
+	replyPreview->forget();
+	medium->unload();
+	full->unload();
+}
+
 ImagePtr PhotoData::makeReplyPreview() {
 	if (replyPreview->isNull() && !thumb->isNull()) {
 		if (thumb->loaded()) {
@@ -1132,6 +1155,28 @@ VoiceData::~VoiceData() {
 DocumentAdditionalData::~DocumentAdditionalData() {
 }
 
+void StickerData::addRendition(uint64 key, const QPixmap &pixmap) {
+	auto i = _renditions.find(key);
+	if (i != _renditions.end()) {
+		imageCacheReleased(int64(i->width()) * i->height() * 4);
+		*i = pixmap;
+	} else {
+		_renditions.insert(key, pixmap);
+	}
+	imageCacheAcquired(int64(pixmap.width()) * pixmap.height() * 4);
+}
+
+void StickerData::clearRenditions() {
+	for_const (auto &pixmap, _renditions) {
+		imageCacheReleased(int64(pixmap.width()) * pixmap.height() * 4);
+	}
+	_renditions.clear();
+}
+
+StickerData::~StickerData() {
+	clearRenditions();
+}
+
 DocumentData::DocumentData(DocumentId id, int32 dc, uint64 accessHash, int32 version, const QString &url, const QVector<MTPDocumentAttribute> &attributes)
 : id(id)
 , _dc(dc)
@@ -1230,9 +1275,70 @@ bool DocumentData::saveToCache() const {
 	return (type == StickerDocument) || (isAnimation() && size < AnimationInMemory) || (voice() && size < AudioVoiceMsgInMemory);
 }
 
+QPixmap DocumentData::stickerPix(int w, int h) {
+	auto s = sticker();
+	if (!s) return QPixmap();
+
+	auto size = QSize(w, h) * cIntRetinaFactor();
+	auto key = (uint64(size.width()) << 32) | uint64(size.height());
+	auto cached = s->rendition(key);
+	if (!cached.isNull()) {
+		return cached;
+	}
+
+	// While the rendition is read from the local storage nothing is returned,
+	// stickerRenditionLoaded() notifies about it to repaint.
+	if (s->renditionLoading(key)) {
+		return QPixmap();
+	} else if (Local::startStickerRenditionLoad(this, size)) {
+		s->setRenditionLoading(key, true);
+		return QPixmap();
+	}
+
+	checkSticker();
+	if (s->img->isNull()) {
+		return QPixmap();
+	}
+	auto image = s->img->pixNoCache(size.width(), size.height(), ImagePixSmooth).toImage();
+	if (qMax(size.width(), size.height()) <= st::maxStickerSize * cIntRetinaFactor()) {
+		Local::writeStickerRendition(id, image);
+	}
+	auto result = App::pixmapFromImageInPlace(std_::move(image));
+	if (cRetina()) result.setDevicePixelRatio(cRetinaFactor());
+	s->addRendition(key, result);
+	return result;
+}
+
+void DocumentData::stickerRenditionLoaded(const QSize &size, QImage &&image) {
+	auto s = sticker();
+	if (!s) return;
+
+	auto key = (uint64(size.width()) << 32) | uint64(size.height());
+	s->setRenditionLoading(key, false);
+	if (!image.isNull()) { // otherwise it is made from the sticker image in the next stickerPix()
+		auto pixmap = App::pixmapFromImageInPlace(std_::move(image));
+		if (cRetina()) pixmap.setDevicePixelRatio(cRetinaFactor());
+		s->addRendition(key, pixmap);
+	}
+	FileDownload::ImageLoaded().notify();
+}
+
 void DocumentData::forget() {
 	thumb->forget();
-	if (sticker()) sticker()->img->forget();
+	if (sticker()) {
+		sticker()->img->forget();
+		sticker()->clearRenditions();
+	}
+	replyPreview->forget();
+	_data.clear();
+}
+
+void DocumentData::unload() {
+	if (sticker()) { // stickers are shown in the panels without any items
+		forget();
+		return;
+	}
+	thumb->unload();
 	replyPreview->forget();
 	_data.clear();
 }
@@ -947,6 +947,7 @@ public:
 	bool uploading() const;
 
 	void forget();
+	void unload(); // when there are no items with this photo
 	ImagePtr makeReplyPreview();
 
 	~PhotoData();
@@ -1035,11 +1036,34 @@ struct StickerData : public DocumentAdditionalData {
 	ImagePtr img;
 	QString alt;
 
+	// Renditions are counted in imageCacheSize(), so they are
+	// cleared by App::checkImageCacheSize() with the other pixmaps.
+	QPixmap rendition(uint64 key) const {
+		return _renditions.value(key);
+	}
+	void addRendition(uint64 key, const QPixmap &pixmap);
+	void clearRenditions();
+	bool renditionLoading(uint64 key) const {
+		return _renditionsLoading.contains(key);
+	}
+	void setRenditionLoading(uint64 key, bool loading) {
+		if (loading) {
+			_renditionsLoading.insert(key);
+		} else {
+			_renditionsLoading.remove(key);
+		}
+	}
+	~StickerData();
+
 	MTPInputStickerSet set = MTP_inputStickerSetEmpty();
 	bool setInstalled() const;
 
 	StorageImageLocation loc; // doc thumb location
 
+private:
+	QMap<uint64, QPixmap> _renditions; // by (width << 32) | height in pixels
+	OrderedSet<uint64> _renditionsLoading; // being read from the local storage
+
 };
 
 struct SongData : public DocumentAdditionalData {
@@ -1104,11 +1128,18 @@ public:
 	void performActionOnLoad();
 
 	void forget();
+	void unload(); // when there are no items with this document
 	ImagePtr makeReplyPreview();
 
 	StickerData *sticker() {
 		return (type == StickerDocument) ? static_cast<StickerData*>(_additional.get()) : nullptr;
 	}
+	// Sticker scaled to the given size. The scaled image is kept in the local
+	// storage, so it can be shown again without decoding the whole sticker.
+	// Returns a null pixmap while the scaled image is being read.
+	QPixmap stickerPix(int w, int h);
+	void stickerRenditionLoaded(const QSize &size, QImage &&image);
+
 	void checkSticker() {
 		StickerData *s = sticker();
 		if (!s) return;
@@ -385,7 +385,7 @@ void CountrySelectBox::Inner::updateFilter(QString filter) {
 
 	QStringList f;
 	if (!filter.isEmpty()) {
-		QStringList filterList = filter.split(cWordSplit(), QString::SkipEmptyParts);
+		QStringList filterList = textSplitWords(filter);
 		int l = filterList.size();
 
 		f.reserve(l);
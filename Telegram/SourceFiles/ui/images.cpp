@@ -673,6 +673,19 @@ void Image::invalidateSizeCache() const {
 	_sizesCache.clear();
 }
 
+int64 Image::memorySize() const {
+	auto result = int64(_saved.size());
+	if (!_data.isNull()) {
+		result += int64(_data.width()) * _data.height() * 4;
+	}
+	for_const (auto &pix, _sizesCache) {
+		if (!pix.isNull()) {
+			result += int64(pix.width()) * pix.height() * 4;
+		}
+	}
+	return result;
+}
+
 Image::~Image() {
 	invalidateSizeCache();
 	if (!_data.isNull()) {
@@ -703,6 +716,28 @@ int64 imageCacheSize() {
 	return globalAcquiredSize;
 }
 
+void imageCacheAcquired(int64 bytes) {
+	globalAcquiredSize += bytes;
+}
+
+void imageCacheReleased(int64 bytes) {
+	globalAcquiredSize -= bytes;
+}
+
+QString imagesMemoryReport() {
+	auto countBytes = [](const auto &images) {
+		auto result = int64(0);
+		for_const (auto image, images) {
+			result += image->memorySize();
+		}
+		return result;
+	};
+	auto localBytes = countBytes(localImages);
+	auto webBytes = countBytes(webImages);
+	auto storageBytes = countBytes(storageImages);
+	return qsl("local: %1 ~%2 kb, web: %3 ~%4 kb, storage: %5 ~%6 kb, all pixels: %7 kb").arg(localImages.size()).arg(localBytes / 1024).arg(webImages.size()).arg(webBytes / 1024).arg(storageImages.size()).arg(storageBytes / 1024).arg(globalAcquiredSize / 1024);
+}
+
 void RemoteImage::doCheckload() const {
 	if (!amLoading() || !_loader->done()) return;
 
@@ -765,6 +800,31 @@ void RemoteImage::setData(QByteArray &bytes, const QByteArray &bytesFormat) {
 }
 
 void RemoteImage::automaticLoad(const HistoryItem *item) {
+	doAutomaticLoad(item, true);
+}
+
+void RemoteImage::automaticPreload(const HistoryItem *item) {
+	doAutomaticLoad(item, false);
+}
+
+void RemoteImage::pausePreload() {
+	if (amLoading() && _loader->loading() && _loader->lowPriority()) {
+		_loader->pause();
+	}
+}
+
+void RemoteImage::preload() {
+	if (loaded()) return;
+
+	if (!_loader) {
+		_loader = createLoader(LoadFromCloudOrLocal, false);
+		if (amLoading()) _loader->start(false, false);
+	} else if (amLoading() && _loader->paused()) {
+		_loader->start(false, false);
+	}
+}
+
+void RemoteImage::doAutomaticLoad(const HistoryItem *item, bool prior) {
 	if (loaded()) return;
 
 	if (_loader != CancelledFileLoader && item) {
@@ -777,9 +837,14 @@ void RemoteImage::automaticLoad(const HistoryItem *item) {
 
 		if (_loader) {
 			if (loadFromCloud) _loader->permitLoadFromCloud();
+			if (prior && _loader->lowPriority()) {
+				_loader->start(); // preloaded image is displayed now
+			} else if (!prior && _loader->paused()) {
+				_loader->start(false, false); // paused preload is in the prefetch range again
+			}
 		} else {
 			_loader = createLoader(loadFromCloud ? LoadFromCloudOrLocal : LoadFromLocalOnly, true);
-			if (_loader) _loader->start();
+			if (_loader) _loader->start(false, prior);
 		}
 	}
 }
@@ -867,6 +932,22 @@ int32 StorageImage::countHeight() const {
 	return _location.height();
 }
 
+void StorageImage::unload() const {
+	if (_location.isNull() || loading()) {
+		forget();
+		return;
+	}
+
+	// The image will be loaded from the local storage or from the cloud.
+	invalidateSizeCache();
+	if (!_data.isNull()) {
+		globalAcquiredSize -= int64(_data.width()) * _data.height() * 4;
+		_data = QPixmap();
+	}
+	_saved = QByteArray();
+	_forgot = false;
+}
+
 void StorageImage::setInformation(int32 size, int32 width, int32 height) {
 	_size = size;
 	_location.setSize(width, height);
@@ -931,6 +1012,14 @@ void DelayedStorageImage::automaticLoad(const HistoryItem *item) {
 	}
 }
 
+void DelayedStorageImage::automaticPreload(const HistoryItem *item) {
+	if (_location.isNull()) {
+		automaticLoad(item);
+	} else {
+		StorageImage::automaticPreload(item);
+	}
+}
+
 void DelayedStorageImage::automaticLoadSettingsChanged() {
 	if (_loadCancelled) _loadCancelled = false;
 	StorageImage::automaticLoadSettingsChanged();
@@ -137,6 +137,12 @@ public:
 
 	virtual void automaticLoad(const HistoryItem *item) { // auto load photo
 	}
+	virtual void automaticPreload(const HistoryItem *item) { // auto load photo with low priority before it is displayed
+	}
+	virtual void pausePreload() { // pause low priority loading if the image was not displayed yet
+	}
+	virtual void preload() { // start low priority loading or resume the paused one, never requeue a started loader
+	}
 	virtual void automaticLoadSettingsChanged() {
 	}
 
@@ -192,6 +198,14 @@ public:
 
 	void forget() const;
 
+	// Forgets the saved image data as well if the image can be loaded again.
+	virtual void unload() const {
+		forget();
+	}
+
+	// Decoded pixels, scaled copies and saved bytes held by this image.
+	int64 memorySize() const;
+
 	QByteArray savedFormat() const {
 		return _format;
 	}
@@ -259,6 +273,9 @@ public:
 	}
 
 	void automaticLoad(const HistoryItem *item); // auto load photo
+	void automaticPreload(const HistoryItem *item);
+	void pausePreload();
+	void preload();
 	void automaticLoadSettingsChanged();
 
 	bool loaded() const;
@@ -297,6 +314,7 @@ private:
 		return _loader && _loader != CancelledFileLoader;
 	}
 	void doCheckload() const;
+	void doAutomaticLoad(const HistoryItem *item, bool prior);
 
 };
 
@@ -310,6 +328,8 @@ public:
 		return _location;
 	}
 
+	void unload() const override;
+
 protected:
 	void setInformation(int32 size, int32 width, int32 height) override;
 	FileLoader *createLoader(LoadFromCloudSetting fromCloud, bool autoLoading) override;
@@ -339,6 +359,7 @@ public:
 	}
 
 	void automaticLoad(const HistoryItem *item); // auto load photo
+	void automaticPreload(const HistoryItem *item);
 	void automaticLoadSettingsChanged();
 
 	bool loading() const {
@@ -433,6 +454,9 @@ inline QSize shrinkToKeepAspect(int32 width, int32 height, int32 towidth, int32
 void clearStorageImages();
 void clearAllImages();
 int64 imageCacheSize();
+void imageCacheAcquired(int64 bytes); // for pixmaps cached outside of the Image objects
+void imageCacheReleased(int64 bytes);
+QString imagesMemoryReport(); // counts and held bytes by image kind
 
 class PsFileBookmark;
 class ReadAccessEnabler {
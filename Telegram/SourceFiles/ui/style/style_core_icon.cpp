@@ -29,7 +29,7 @@ uint32 colorKey(const QColor &c) {
 	return (((((uint32(c.red()) << 8) | uint32(c.green())) << 8) | uint32(c.blue())) << 8) | uint32(c.alpha());
 }
 
-using IconPixmaps = QMap<QPair<const IconMask*, uint32>, QPixmap>;
+using IconPixmaps = QHash<QPair<const IconMask*, uint32>, QPixmap>;
 NeverFreedPointer<IconPixmaps> iconPixmaps;
 
 inline int pxAdjust(int value, int scale) {
@@ -39,32 +39,45 @@ inline int pxAdjust(int value, int scale) {
 	return qFloor((value * scale / 4.) + 0.1);
 }
 
-QPixmap createIconPixmap(const IconMask *mask, const Color &color) {
-	auto maskImage = QImage::fromData(mask->data(), mask->size(), "PNG");
-	t_assert(!maskImage.isNull());
+// Masks are generated by codegen_style as separate pngs for each scale
+// in the order 100x, 125x, 150x, 200x, we decode only the one we need.
+QImage createIconMaskImage(const IconMask *mask) {
+	const uchar *data = mask->data();
+	int size = mask->size();
 
-	// images are layouted like this:
-	// 200x 100x
-	// 150x 125x
-	int width = maskImage.width() / 3;
-	int height = qRound((maskImage.height() * 2) / 7.);
-	auto r = QRect(0, 0, width * 2, height * 2);
+	auto scalesTag = qstr("SCALES:");
+	t_assert(size > scalesTag.size() && !memcmp(data, scalesTag.data(), scalesTag.size()));
+	size -= scalesTag.size();
+	data += scalesTag.size();
+
+	auto scaleIndex = 3;
 	if (!cRetina() && cScale() != dbisTwo) {
-		if (cScale() == dbisOne) {
-			r = QRect(width * 2, 0, width, height);
-		} else {
-			int width125 = pxAdjust(width, 5);
-			int height125 = pxAdjust(height, 5);
-			int width150 = pxAdjust(width, 6);
-			int height150 = pxAdjust(height, 6);
-			if (cScale() == dbisOneAndQuarter) {
-				r = QRect(width150, height * 2, width125, height125);
-			} else {
-				r = QRect(0, height * 2, width150, height150);
-			}
-		}
+		scaleIndex = (cScale() == dbisOne) ? 0 : (cScale() == dbisOneAndQuarter) ? 1 : 2;
 	}
-	auto finalImage = colorizeImage(maskImage, color, r);
+
+	auto baForStream = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+	QBuffer buffer(&baForStream);
+	buffer.open(QIODevice::ReadOnly);
+
+	QDataStream stream(&buffer);
+	stream.setVersion(QDataStream::Qt_5_1);
+	for (auto i = 0; i != scaleIndex; ++i) {
+		quint32 skipSize = 0;
+		stream >> skipSize;
+		stream.skipRawData(skipSize);
+	}
+	quint32 pngSize = 0;
+	stream >> pngSize;
+	t_assert(stream.status() == QDataStream::Ok && buffer.pos() + pngSize <= size);
+
+	return QImage::fromData(data + buffer.pos(), pngSize, "PNG");
+}
+
+QPixmap createIconPixmap(const IconMask *mask, const Color &color) {
+	auto maskImage = createIconMaskImage(mask);
+	t_assert(!maskImage.isNull());
+
+	auto finalImage = colorizeImage(maskImage, color, maskImage.rect());
 	finalImage.setDevicePixelRatio(cRetinaFactor());
 	return App::pixmapFromImageInPlace(std_::move(finalImage));
 }
@@ -296,6 +296,8 @@ private:
 
 };
 
+int ITextBlock::_aliveCount = 0;
+
 QFixed ITextBlock::f_rbearing() const {
 	return (type() == TextBlockTText) ? static_cast<const TextBlock*>(this)->real_f_rbearing() : 0;
 }
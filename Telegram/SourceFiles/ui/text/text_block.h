@@ -51,6 +51,16 @@ public:
 				_lpadding = font->spacew;
 			}
 		}
+		++_aliveCount;
+	}
+	ITextBlock(const ITextBlock &other) : _from(other._from), _flags(other._flags), _width(other._width), _lpadding(other._lpadding), _rpadding(other._rpadding) {
+		++_aliveCount;
+	}
+	ITextBlock &operator=(const ITextBlock &other) = default;
+
+	// Blocks of all Text objects, for memory reports. Main thread only.
+	static int aliveCount() {
+		return _aliveCount;
 	}
 
 	uint16 from() const {
@@ -98,6 +108,7 @@ public:
 
 	virtual ITextBlock *clone() const = 0;
 	virtual ~ITextBlock() {
+		--_aliveCount;
 	}
 
 protected:
@@ -108,6 +119,9 @@ protected:
 
 	QFixed _width, _lpadding, _rpadding;
 
+private:
+	static int _aliveCount;
+
 };
 
 class NewlineBlock : public ITextBlock {
@@ -1107,8 +1107,57 @@ inline QChar chNoAccent(int32 code) {
 	}
 	return QChar(0);
 }
+
+// All chNoAccent() codes are in the BMP, so the results are put in pages of
+// 256 chars, only the pages with at least one accented char are stored.
+class NoAccentTable {
+public:
+	NoAccentTable() {
+		for (int32 page = 0; page < 256; ++page) {
+			for (int32 index = 0; index < 256; ++index) {
+				auto noAccent = chNoAccent((page << 8) | index).unicode();
+				if (!noAccent) continue;
+
+				if (!_pages[page]) {
+					_data.resize(_data.size() + 256);
+					_pages[page] = _data.size() / 256;
+				}
+				_data[(_pages[page] - 1) * 256 + index] = noAccent;
+			}
+		}
+	}
+
+	QChar noAccent(uint32 code) const {
+		if (code > 0xFFFF) return QChar(0);
+
+		auto page = _pages[code >> 8];
+		return page ? QChar(_data.at((page - 1) * 256 + (code & 0xFF))) : QChar(0);
+	}
+
+private:
+	uchar _pages[256] = { 0 }; // index of the page in _data plus one
+	QVector<ushort> _data;
+
+};
+
+const NoAccentTable &noAccentTable() {
+	static NoAccentTable table;
+	return table;
+}
+
+inline bool chIsWordSplit(QChar ch) {
+	switch (ch.unicode()) {
+	case '@': case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+	case '-': case '+': case '(': case ')': case '[': case ']': case '{': case '}':
+	case '<': case '>': case ',': case '.': case ':': case '!': case '_': case ';':
+	case '"': case '\'': case 0:
+		return true;
+	}
+	return false;
 }
 
+} // namespace
+
 QString textClean(const QString &text) {
 	QString result(text);
 	for (const QChar *s = text.unicode(), *ch = s, *e = text.unicode() + text.size(); ch != e; ++ch) {
@@ -1164,10 +1213,22 @@ QString textOneLine(const QString &text, bool trim, bool rich) {
 }
 
 QString textAccentFold(const QString &text) {
+	const auto &table = noAccentTable();
+
 	QString result(text);
 	bool copying = false;
 	int32 i = 0;
 	for (const QChar *s = text.unicode(), *ch = s, *e = text.unicode() + text.size(); ch != e; ++ch, ++i) {
+		if (!copying) { // skip ascii chars four at a time, they stay in place
+			quint64 four;
+			while (e - ch >= 4) {
+				memcpy(&four, ch, sizeof(four));
+				if (four & 0xFF80FF80FF80FF80ULL) break;
+				ch += 4;
+				i += 4;
+			}
+			if (ch == e) break;
+		}
 		if (ch->unicode() < 128) {
 			if (copying) result[i] = *ch;
 			continue;
@@ -1178,7 +1239,7 @@ QString textAccentFold(const QString &text) {
 			continue;
 		}
 		if (ch->isHighSurrogate() && ch + 1 < e && (ch + 1)->isLowSurrogate()) {
-			QChar noAccent = chNoAccent(QChar::surrogateToUcs4(*ch, *(ch + 1)));
+			QChar noAccent = table.noAccent(QChar::surrogateToUcs4(*ch, *(ch + 1)));
 			if (noAccent.unicode() > 0) {
 				copying = true;
 				result[i] = noAccent;
@@ -1188,7 +1249,7 @@ QString textAccentFold(const QString &text) {
 				if (copying) result[i] = *ch;
 			}
 		} else {
-			QChar noAccent = chNoAccent(ch->unicode());
+			QChar noAccent = table.noAccent(ch->unicode());
 			if (noAccent.unicode() > 0 && noAccent != *ch) {
 				result[i] = noAccent;
 			} else if (copying) {
@@ -1203,6 +1264,23 @@ QString textSearchKey(const QString &text) {
 	return textAccentFold(text.trimmed().toLower());
 }
 
+QStringList textSplitWords(const QString &text) {
+	QStringList result;
+	const QChar *s = text.unicode(), *e = s + text.size(), *wordStart = s;
+	for (const QChar *ch = s; ch != e; ++ch) {
+		if (chIsWordSplit(*ch)) {
+			if (ch > wordStart) {
+				result.push_back(text.mid(wordStart - s, ch - wordStart));
+			}
+			wordStart = ch + 1;
+		}
+	}
+	if (e > wordStart) {
+		result.push_back(text.mid(wordStart - s, e - wordStart));
+	}
+	return result;
+}
+
 bool textSplit(QString &sendingText, EntitiesInText &sendingEntities, QString &leftText, EntitiesInText &leftEntities, int32 limit) {
 	if (leftText.isEmpty() || !limit) return false;
 
@@ -1442,6 +1520,42 @@ MTPVector<MTPMessageEntity> linksToMTP(const EntitiesInText &links, bool sending
 	return result;
 }
 
+namespace {
+
+// Keeps the last match of the expression and searches again only when the
+// offset has passed the match start. The first match after the new offset is
+// the same match in that case, so each expression scans the text about once
+// instead of once per entity found by any of them.
+class LazyMatch {
+public:
+	LazyMatch(const QRegularExpression &re, const QString &text, bool enabled = true)
+		: _re(re)
+		, _text(text)
+		, _enabled(enabled) {
+	}
+
+	QRegularExpressionMatch from(int offset) {
+		if (!_enabled) {
+			return QRegularExpressionMatch();
+		}
+		if (offset < _offset || (_match.hasMatch() && _match.capturedStart() < offset)) {
+			_match = _re.match(_text, offset);
+			_offset = offset;
+		}
+		return _match;
+	}
+
+private:
+	const QRegularExpression &_re;
+	const QString &_text;
+	bool _enabled;
+	int _offset = INT_MAX;
+	QRegularExpressionMatch _match;
+
+};
+
+} // namespace
+
 // Some code is duplicated in flattextarea.cpp!
 void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities, bool rich) {
 	EntitiesInText result;
@@ -1460,6 +1574,7 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 		int32 offset = 0, matchOffset = offset, len = text.size(), commandOffset = rich ? 0 : len;
 		bool inLink = false, commandIsLink = false;
 		const QChar *start = text.constData();
+		LazyMatch lazyPre(_rePre, text), lazyCode(_reCode, text);
 		for (; matchOffset < len;) {
 			if (commandOffset <= matchOffset) {
 				for (commandOffset = matchOffset; commandOffset < len; ++commandOffset) {
@@ -1474,8 +1589,8 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 					commandIsLink = false;
 				}
 			}
-			auto mPre = _rePre.match(text, matchOffset);
-			auto mCode = _reCode.match(text, matchOffset);
+			auto mPre = lazyPre.from(matchOffset);
+			auto mCode = lazyCode.from(matchOffset);
 			if (!mPre.hasMatch() && !mCode.hasMatch()) break;
 
 			int preStart = mPre.hasMatch() ? mPre.capturedStart() : INT_MAX,
@@ -1610,6 +1725,8 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 	int32 len = text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = text.constData(), *end = start + text.size();
+	LazyMatch lazyDomain(_reDomain, text), lazyExplicitDomain(_reExplicitDomain, text);
+	LazyMatch lazyHashtag(_reHashtag, text, withHashtags), lazyMention(_reMention, text, withMentions), lazyBotCommand(_reBotCommand, text, withBotCommands);
 	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; offset < len;) {
 		if (commandOffset <= offset) {
 			for (commandOffset = offset; commandOffset < len; ++commandOffset) {
@@ -1620,11 +1737,11 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 				}
 			}
 		}
-		auto mDomain = _reDomain.match(text, matchOffset);
-		auto mExplicitDomain = _reExplicitDomain.match(text, matchOffset);
-		auto mHashtag = withHashtags ? _reHashtag.match(text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? _reMention.match(text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? _reBotCommand.match(text, matchOffset) : QRegularExpressionMatch();
+		auto mDomain = lazyDomain.from(matchOffset);
+		auto mExplicitDomain = lazyExplicitDomain.from(matchOffset);
+		auto mHashtag = lazyHashtag.from(matchOffset);
+		auto mMention = lazyMention.from(qMax(mentionSkip, matchOffset));
+		auto mBotCommand = lazyBotCommand.from(matchOffset);
 
 		EntityInTextType lnkType = EntityInTextUrl;
 		int32 lnkStart = 0, lnkLength = 0;
@@ -1655,7 +1772,7 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 			}
 			if (!(start + mentionStart + 1)->isLetter() || !(start + mentionEnd - 1)->isLetterOrNumber()) {
 				mentionSkip = mentionEnd;
-				mMention = _reMention.match(text, qMax(mentionSkip, matchOffset));
+				mMention = lazyMention.from(qMax(mentionSkip, matchOffset));
 				if (mMention.hasMatch()) {
 					mentionStart = mMention.capturedStart();
 					mentionEnd = mMention.capturedEnd();
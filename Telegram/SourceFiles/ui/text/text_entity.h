@@ -131,6 +131,7 @@ QString textRichPrepare(const QString &text);
 QString textOneLine(const QString &text, bool trim = true, bool rich = false);
 QString textAccentFold(const QString &text);
 QString textSearchKey(const QString &text);
+QStringList textSplitWords(const QString &text); // by spaces and punctuation, skipping empty words
 bool textSplit(QString &sendingText, EntitiesInText &sendingEntities, QString &leftText, EntitiesInText &leftEntities, int32 limit);
 
 enum {
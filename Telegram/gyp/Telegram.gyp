@@ -211,6 +211,8 @@
       '<(src_loc)/core/click_handler_types.cpp',
       '<(src_loc)/core/click_handler_types.h',
       '<(src_loc)/core/lambda_wrap.h',
+      '<(src_loc)/core/memory_pool.cpp',
+      '<(src_loc)/core/memory_pool.h',
       '<(src_loc)/core/observer.cpp',
       '<(src_loc)/core/observer.h',
       '<(src_loc)/core/ordered_set.h',
@@ -231,6 +233,10 @@
       '<(src_loc)/data/data_abstract_structure.h',
       '<(src_loc)/data/data_drafts.cpp',
       '<(src_loc)/data/data_drafts.h',
+      '<(src_loc)/data/data_media_prefetch.cpp',
+      '<(src_loc)/data/data_media_prefetch.h',
+      '<(src_loc)/data/data_userpics.cpp',
+      '<(src_loc)/data/data_userpics.h',
       '<(src_loc)/dialogs/dialogs_indexed_list.cpp',
       '<(src_loc)/dialogs/dialogs_indexed_list.h',
       '<(src_loc)/dialogs/dialogs_layout.cpp',